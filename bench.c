@@ -0,0 +1,130 @@
+/*
+ * bench.c - benchmark harness for host and target builds
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "bench.h"
+#include <stdio.h>
+
+/*
+ * Each benchmark is first calibrated: the iteration count doubles until one
+ * repetition takes at least MIN_TICKS. That run doubles as the warmup (caches,
+ * branch predictors, lazily built tables). Then BENCH_REPS repetitions are
+ * timed and the fastest is reported - the slower ones only measured
+ * interference from somewhere else.
+ *
+ * On the FireBee the clock is the 200 Hz system timer, which needs supervisor
+ * mode, so the benchmarks have to run from Supexec(). Results are collected
+ * and only printed by bench_report(), outside of supervisor mode.
+ */
+#ifdef __MINT__
+#include "sysvars.h"
+
+#define TICKS_PER_SECOND    200L
+#define MIN_TICKS           40                      /* 200 ms, the timer is coarse */
+
+uint32_t bench_ticks(void)
+{
+    return hz_200;
+}
+#else
+#include <time.h>
+
+#define TICKS_PER_SECOND    1000000L                /* microseconds */
+#define MIN_TICKS           20000
+
+uint32_t bench_ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+static struct bench_result results[BENCH_MAX_RESULTS];
+static short num_results;
+
+long bench_ticks_per_second(void)
+{
+    return TICKS_PER_SECOND;
+}
+
+static uint32_t time_run(bench_func func, void *arg, long iterations)
+{
+    uint32_t start;
+
+    /* start on a tick boundary, so the coarse target timer doesn't lose a partial tick */
+    start = bench_ticks();
+    while (bench_ticks() == start)
+        ;
+    start = bench_ticks();
+
+    func(arg, iterations);
+
+    return bench_ticks() - start;
+}
+
+/*
+ * time <func>, which moves <bytes_per_op> bytes per iteration (0 if that
+ * isn't meaningful), and record the result under <name>
+ */
+void bench_run(const char *name, bench_func func, void *arg, long bytes_per_op)
+{
+    struct bench_result *r;
+    long iterations = 1;
+    uint32_t best;
+
+    if (num_results >= BENCH_MAX_RESULTS)
+        return;
+
+    while (time_run(func, arg, iterations) < MIN_TICKS && iterations < 0x40000000L)
+        iterations *= 2;
+
+    best = 0xffffffff;
+    for (short i = 0; i < BENCH_REPS; i++)
+    {
+        uint32_t t = time_run(func, arg, iterations);
+
+        if (t < best)
+            best = t;
+    }
+    if (best == 0)
+        best = 1;
+
+    r = &results[num_results++];
+    r->name = name;
+    r->iterations = iterations;
+    r->ns_per_op = (double) best * (1e9 / TICKS_PER_SECOND) / iterations;
+    r->mb_per_s = bytes_per_op ? (double) bytes_per_op * iterations * TICKS_PER_SECOND / best / 1e6 : 0;
+}
+
+void bench_report(void)
+{
+    printf("%-32s %10s %12s %10s\r\n", "benchmark", "iterations", "ns/op", "MB/s");
+
+    for (short i = 0; i < num_results; i++)
+    {
+        struct bench_result *r = &results[i];
+
+        if (r->mb_per_s > 0)
+            printf("%-32s %10ld %12.1f %10.1f\r\n", r->name, r->iterations, r->ns_per_op, r->mb_per_s);
+        else
+            printf("%-32s %10ld %12.1f %10s\r\n", r->name, r->iterations, r->ns_per_op, "-");
+    }
+    num_results = 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * bench.h - benchmark harness for host and target builds
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#define BENCH_REPS          5       /* timed repetitions, the fastest one counts */
+#define BENCH_MAX_RESULTS   64
+
+/* run the benchmarked operation <iterations> times */
+typedef void (*bench_func)(void *arg, long iterations);
+
+struct bench_result
+{
+    const char *name;
+    long iterations;                /* per repetition */
+    double ns_per_op;
+    double mb_per_s;                /* 0 if the operation doesn't move bytes */
+};
+
+uint32_t bench_ticks(void);
+long bench_ticks_per_second(void);
+
+void bench_run(const char *name, bench_func func, void *arg, long bytes_per_op);
+void bench_report(void);
+
+#endif /* BENCH_H */
@@ -0,0 +1,231 @@
+/*
+ * benchrun.c - benchmarks of the timing math and the drawing kernels
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "bench.h"
+#include "modeline.h"
+#include "videl.h"
+#include "pixel.h"
+#include "convert.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Built for the host with 'make bench', for the FireBee as bench.prg. Both
+ * draw into an ordinary RAM buffer laid out like a screen, so the numbers
+ * are those of the kernels, not of the video RAM (that is what blitbench.prg
+ * and pixelbench.prg are for).
+ */
+#ifdef __MINT__
+#include <osbind.h>
+#endif
+
+#define FB_WIDTH    640
+#define FB_HEIGHT   480
+
+static struct vram_surface fb;
+static void *fb_block;
+static uint8_t *line_buf;           /* one line of source pixels for the converters */
+static uint8_t *line_out;
+
+static volatile long sink;          /* keeps results from being optimized away */
+
+struct mode_arg
+{
+    short width;
+    short height;
+    short refresh;
+};
+
+static const struct mode_arg vga = { 640, 480, 60 };
+static const struct mode_arg full_hd = { 1920, 1080, 60 };
+
+static void bench_gtf(void *arg, long n)
+{
+    const struct mode_arg *m = arg;
+    struct modeline ml;
+
+    while (n-- > 0)
+    {
+        general_timing_formula(m->width, m->height, m->refresh, 0, &ml);
+        sink += ml.h_total;
+    }
+}
+
+static void bench_gtf_fixed(void *arg, long n)
+{
+    const struct mode_arg *m = arg;
+    struct modeline ml;
+
+    while (n-- > 0)
+    {
+        general_timing_formula_fixed(&gtf_default_display, m->width, m->height, m->refresh, 0, &ml);
+        sink += ml.h_total;
+    }
+}
+
+static void bench_cvt(void *arg, long n)
+{
+    const struct mode_arg *m = arg;
+    struct modeline ml;
+
+    while (n-- > 0)
+    {
+        coordinated_video_timing(m->width, m->height, m->refresh, 0, 0, &ml);
+        sink += ml.h_total;
+    }
+}
+
+static void bench_videl_timing(void *arg, long n)
+{
+    struct modeline ml;
+    struct videl_timing vt;
+
+    (void) arg;
+    general_timing_formula(640, 480, 60, 0, &ml);
+    while (n-- > 0)
+    {
+        videl_timing_from_modeline(&ml, &vt);
+        sink += vt.hht;
+    }
+}
+
+static void bench_fill(void *arg, long n)
+{
+    (void) arg;
+    while (n-- > 0)
+        pixel_fill_rect(&fb, 0, 0, FB_WIDTH, FB_HEIGHT, n);
+}
+
+static void bench_fill_small(void *arg, long n)
+{
+    (void) arg;
+    while (n-- > 0)
+        pixel_fill_rect(&fb, 3, 5, 13, 13, n);
+}
+
+static void bench_copy(void *arg, long n)
+{
+    (void) arg;
+    while (n-- > 0)
+        pixel_copy_rect(&fb, 0, 0, &fb, 16, FB_HEIGHT / 2, FB_WIDTH - 16, FB_HEIGHT / 2);
+}
+
+static void bench_put(void *arg, long n)
+{
+    (void) arg;
+    while (n-- > 0)
+        pixel_put(&fb, n & 511, n & 255, n);
+}
+
+static void bench_get(void *arg, long n)
+{
+    (void) arg;
+    while (n-- > 0)
+        sink += pixel_get(&fb, n & 511, n & 255);
+}
+
+struct convert_arg
+{
+    enum pixel_format dfmt;
+    enum pixel_format sfmt;
+};
+
+static void bench_convert(void *arg, long n)
+{
+    const struct convert_arg *c = arg;
+
+    while (n-- > 0)
+        convert_pixels(line_out, c->dfmt, line_buf, c->sfmt, FB_WIDTH);
+}
+
+static const struct convert_arg rgb888_to_565 = { PIXFMT_RGB565, PIXFMT_RGB888 };
+static const struct convert_arg argb_to_565le = { PIXFMT_RGB565_LE, PIXFMT_ARGB8888 };
+static const struct convert_arg rgb565_to_argb = { PIXFMT_ARGB8888, PIXFMT_RGB565 };
+static const struct convert_arg index8_to_argb = { PIXFMT_ARGB8888, PIXFMT_INDEX8 };
+
+static const char * const fill_names[] = { "fill 640x480x1", "fill 640x480x8", "fill 640x480x16", "fill 640x480x24" };
+static const char * const copy_names[] = { "copy 624x240x1", "copy 624x240x8", "copy 624x240x16", "copy 624x240x24" };
+static const char * const small_names[] = { "fill 13x13x1", "fill 13x13x8", "fill 13x13x16", "fill 13x13x24" };
+static const char * const put_names[] = { "put pixel 1", "put pixel 8", "put pixel 16", "put pixel 24" };
+static const char * const get_names[] = { "get pixel 1", "get pixel 8", "get pixel 16", "get pixel 24" };
+static const short depths[] = { 1, 8, 16, 24 };
+
+static long run_benchmarks(void)
+{
+    bench_run("gtf 640x480@60", bench_gtf, (void *) &vga, 0);
+    bench_run("gtf 1920x1080@60", bench_gtf, (void *) &full_hd, 0);
+    bench_run("gtf fixed 640x480@60", bench_gtf_fixed, (void *) &vga, 0);
+    bench_run("gtf fixed 1920x1080@60", bench_gtf_fixed, (void *) &full_hd, 0);
+    bench_run("cvt 1920x1080@60", bench_cvt, (void *) &full_hd, 0);
+    bench_run("videl timing from modeline", bench_videl_timing, NULL, 0);
+
+    for (short d = 0; d < 4; d++)
+    {
+        long bytes = (long) FB_WIDTH * fb_pixel_bits(depths[d]) / 8;
+
+        fb.bpp = depths[d];
+        fb.pitch = vram_pitch(FB_WIDTH, depths[d]);
+
+        bench_run(fill_names[d], bench_fill, NULL, bytes * FB_HEIGHT);
+        bench_run(small_names[d], bench_fill_small, NULL, 13L * 13 * fb_pixel_bits(depths[d]) / 8);
+        bench_run(copy_names[d], bench_copy, NULL, (bytes - 16L * fb_pixel_bits(depths[d]) / 8) * FB_HEIGHT / 2);
+        bench_run(put_names[d], bench_put, NULL, 0);
+        bench_run(get_names[d], bench_get, NULL, 0);
+    }
+
+    bench_run("convert 640 rgb888 to rgb565", bench_convert, (void *) &rgb888_to_565, FB_WIDTH * 3L);
+    bench_run("convert 640 argb8888 to rgb565le", bench_convert, (void *) &argb_to_565le, FB_WIDTH * 4L);
+    bench_run("convert 640 rgb565 to argb8888", bench_convert, (void *) &rgb565_to_argb, FB_WIDTH * 2L);
+    bench_run("convert 640 index8 to argb8888", bench_convert, (void *) &index8_to_argb, FB_WIDTH);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long size = vram_pitch(FB_WIDTH, 24) * FB_HEIGHT;
+
+    fb_block = malloc(size + 15);
+    line_buf = malloc(FB_WIDTH * 4);
+    line_out = malloc(FB_WIDTH * 4);
+    if (fb_block == NULL || line_buf == NULL || line_out == NULL)
+    {
+        fprintf(stderr, "%s: out of memory\r\n", argv[0]);
+        exit(1);
+    }
+    fb.addr = (void *) (((uintptr_t) fb_block + 15) & ~(uintptr_t) 15);
+    fb.width = FB_WIDTH;
+    fb.height = FB_HEIGHT;
+
+    for (short i = 0; i < FB_WIDTH * 4; i++)
+        line_buf[i] = rand();
+
+#ifdef __MINT__
+    Supexec(run_benchmarks);
+#else
+    run_benchmarks();
+#endif
+    bench_report();
+
+    free(line_out);
+    free(line_buf);
+    free(fb_block);
+
+    return 0;
+}
@@ -0,0 +1,354 @@
+/*
+ * blit.c - blitter accelerated rectangle operations
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "blit.h"
+#include "fb_video.h"
+#include <string.h>
+#include <osbind.h>
+
+/*
+ * The blitter works on 16 bit words with first/middle/last word end masks, so
+ * a rectangle is described by the words it touches in each line. This covers
+ * every depth as long as source and destination share the same bit offset
+ * within a word (we don't do skew), which is always true for 16 and 32 bit
+ * pixels. Fills need a one word halftone pattern, so 32 bit fills are done in
+ * software. So is everything while the blitter is busy (owned by someone else)
+ * or if there is no blitter at all.
+ */
+short blit_hw_enable = 1;
+static short blitter_present;
+
+static volatile struct blitter_registers * const blt = &blitter;
+
+enum blit_ops
+{
+    BLIT_OP_SOURCE = 3,
+};
+
+#define BLIT_BUSY   0x80
+#define BLIT_HOG    0x40
+
+/* the words a rectangle touches in one line */
+struct blit_span
+{
+    long first;         /* byte offset of the first word from the line start */
+    short words;
+    uint16_t mask_left;
+    uint16_t mask_right;
+};
+
+static void calc_span(short x, short w, short bits, struct blit_span *span)
+{
+    long start = (long) x * bits;
+    long end = (long) (x + w) * bits - 1;
+
+    span->first = start / 16 * 2;
+    span->words = end / 16 - start / 16 + 1;
+    span->mask_left = 0xffff >> (start % 16);
+    span->mask_right = 0xffff << (15 - end % 16);
+    if (span->words == 1)
+        span->mask_left = span->mask_right = span->mask_left & span->mask_right;
+}
+
+static uint16_t *line_addr(struct vram_surface *s, short y)
+{
+    return (uint16_t *) ((char *) s->addr + (long) y * s->pitch);
+}
+
+/*
+ * XBIOS Blitmode() tells whether there is a blitter (bit 1). Needs to be called
+ * before the blitter is used
+ */
+int blit_init(void)
+{
+    blitter_present = (Blitmode(-1) & 2) != 0;
+
+    return blitter_present ? 0 : -1;
+}
+
+static int blitter_usable(void)
+{
+    return blit_hw_enable && blitter_present && !(*(volatile uint8_t *) &blt->status & BLIT_BUSY);
+}
+
+/*
+ * busy, hog and the halftone line number need to go out in one byte write,
+ * setting the bitfields one by one would start the blitter too early
+ */
+static void blitter_run(short lineno)
+{
+    volatile uint8_t *status = (volatile uint8_t *) &blt->status;
+
+    *status = BLIT_BUSY | BLIT_HOG | (lineno & 15);
+
+    /* in hog mode the CPU is off the bus until the blitter is done, but make sure */
+    do {} while (*status & BLIT_BUSY);
+}
+
+/*
+ * write <pattern[line & 15]> through the masks of <span> into <h> lines from
+ * line <y> on - the blitter's HOP_HALFTONE_ONLY, source op
+ */
+static void halftone_hw(struct vram_surface *dst, short y, short h, const struct blit_span *span,
+                        const uint16_t *pattern)
+{
+    for (short i = 0; i < 16; i++)
+        blt->halftone[i] = pattern[i];
+
+    blt->endmask_1 = span->mask_left;
+    blt->endmask_2 = 0xffff;
+    blt->endmask_3 = span->mask_right;
+    blt->dst_x_incr = 2;
+    blt->dst_y_incr = dst->pitch - (span->words - 1) * 2;
+    blt->dst_addr = (uint16_t *) ((char *) line_addr(dst, y) + span->first);
+    blt->x_count = span->words;
+    blt->y_count = h;
+    blt->hop = HOP_HALFTONE_ONLY;
+    blt->op = BLIT_OP_SOURCE;
+    *(volatile uint8_t *) &blt->skew = 0;
+
+    blitter_run(y);
+}
+
+static void halftone_sw(struct vram_surface *dst, short y, short h, const struct blit_span *span,
+                        const uint16_t *pattern)
+{
+    for (short line = y; line < y + h; line++)
+    {
+        uint16_t *p = (uint16_t *) ((char *) line_addr(dst, line) + span->first);
+        uint16_t pat = pattern[line & 15];
+
+        if (span->words == 1)
+        {
+            *p = (*p & ~span->mask_left) | (pat & span->mask_left);
+            continue;
+        }
+
+        *p = (*p & ~span->mask_left) | (pat & span->mask_left);
+        p++;
+        for (short i = span->words - 2; i > 0; i--)
+            *p++ = pat;
+        *p = (*p & ~span->mask_right) | (pat & span->mask_right);
+    }
+}
+
+static void fill32_sw(struct vram_surface *dst, short x, short y, short w, short h, uint32_t color)
+{
+    for (short line = y; line < y + h; line++)
+    {
+        uint32_t *p = (uint32_t *) line_addr(dst, line) + x;
+
+        for (short i = 0; i < w; i++)
+            *p++ = color;
+    }
+}
+
+/*
+ * fill a rectangle with <color> (a pixel value of the surface's depth).
+ * Returns 1 if the blitter did it, 0 if it was done in software
+ */
+int blit_fill(struct vram_surface *dst, short x, short y, short w, short h, uint32_t color)
+{
+    short bits = fb_pixel_bits(dst->bpp);
+    struct blit_span span;
+    uint16_t pattern[16];
+    uint16_t word;
+
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    if (bits == 32)
+    {
+        fill32_sw(dst, x, y, w, h, color);
+        return 0;
+    }
+
+    if (bits == 1)
+        word = color & 1 ? 0xffff : 0;
+    else if (bits == 8)
+        word = (color & 0xff) * 0x0101;
+    else
+        word = color;
+
+    for (short i = 0; i < 16; i++)
+        pattern[i] = word;
+
+    calc_span(x, w, bits, &span);
+
+    if (blitter_usable())
+    {
+        halftone_hw(dst, y, h, &span, pattern);
+        return 1;
+    }
+
+    halftone_sw(dst, y, h, &span, pattern);
+    return 0;
+}
+
+/*
+ * fill a rectangle with the 16 line halftone <pattern>, aligned to the surface's
+ * lines and words (the pattern word repeats every 16 / bpp pixels).
+ * Returns 1 if the blitter did it, 0 if it was done in software
+ */
+int blit_pattern(struct vram_surface *dst, short x, short y, short w, short h, const uint16_t *pattern)
+{
+    struct blit_span span;
+
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    calc_span(x, w, fb_pixel_bits(dst->bpp), &span);
+
+    if (blitter_usable())
+    {
+        halftone_hw(dst, y, h, &span, pattern);
+        return 1;
+    }
+
+    halftone_sw(dst, y, h, &span, pattern);
+    return 0;
+}
+
+static void copy_hw(struct vram_surface *src, short sx, short sy,
+                    struct vram_surface *dst, short dy, short h, short bits,
+                    const struct blit_span *dspan, int backwards)
+{
+    long sfirst = (long) sx * bits / 16 * 2;
+    long last = (dspan->words - 1) * 2;
+
+    blt->endmask_2 = 0xffff;
+    blt->x_count = dspan->words;
+    blt->y_count = h;
+    blt->hop = HOP_SOURCE_ONLY;
+    blt->op = BLIT_OP_SOURCE;
+    *(volatile uint8_t *) &blt->skew = 0;
+
+    if (!backwards)
+    {
+        blt->endmask_1 = dspan->mask_left;
+        blt->endmask_3 = dspan->mask_right;
+        blt->src_x_incr = 2;
+        blt->src_y_incr = src->pitch - last;
+        blt->dst_x_incr = 2;
+        blt->dst_y_incr = dst->pitch - last;
+        blt->src_addr = (uint16_t *) ((char *) line_addr(src, sy) + sfirst);
+        blt->dst_addr = (uint16_t *) ((char *) line_addr(dst, dy) + dspan->first);
+    }
+    else
+    {
+        /* start with the last word of the last line and work towards the top left */
+        blt->endmask_1 = dspan->mask_right;
+        blt->endmask_3 = dspan->mask_left;
+        blt->src_x_incr = -2;
+        blt->src_y_incr = last - src->pitch;
+        blt->dst_x_incr = -2;
+        blt->dst_y_incr = last - dst->pitch;
+        blt->src_addr = (uint16_t *) ((char *) line_addr(src, sy + h - 1) + sfirst + last);
+        blt->dst_addr = (uint16_t *) ((char *) line_addr(dst, dy + h - 1) + dspan->first + last);
+    }
+
+    blitter_run(0);
+}
+
+static void copy_sw(struct vram_surface *src, short sx, short sy,
+                    struct vram_surface *dst, short dy, short h, short bits,
+                    const struct blit_span *dspan, int backwards)
+{
+    long sfirst = (long) sx * bits / 16 * 2;
+    short step = backwards ? -1 : 1;
+    short line = backwards ? h - 1 : 0;
+
+    for (short n = 0; n < h; n++, line += step)
+    {
+        uint16_t *s = (uint16_t *) ((char *) line_addr(src, sy + line) + sfirst);
+        uint16_t *d = (uint16_t *) ((char *) line_addr(dst, dy + line) + dspan->first);
+        uint16_t first = *s;
+        uint16_t last = s[dspan->words - 1];
+        uint16_t d_first = *d;
+        uint16_t d_last = d[dspan->words - 1];
+
+        memmove(d, s, dspan->words * 2);
+
+        d[0] = (d_first & ~dspan->mask_left) | (first & dspan->mask_left);
+        if (dspan->words > 1)
+            d[dspan->words - 1] = (d_last & ~dspan->mask_right) | (last & dspan->mask_right);
+    }
+}
+
+/*
+ * copy a rectangle between (or within) surfaces of the same depth. Overlapping
+ * rectangles are handled. Returns 1 if the blitter did it, 0 if it was done in software
+ */
+int blit_copy(struct vram_surface *src, short sx, short sy,
+              struct vram_surface *dst, short dx, short dy, short w, short h)
+{
+    short bits = fb_pixel_bits(dst->bpp);
+    struct blit_span span;
+    int backwards;
+
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    calc_span(dx, w, bits, &span);
+
+    /* overlapping copy down or right: go bottom up, right to left */
+    backwards = src->addr == dst->addr && (dy > sy || (dy == sy && dx > sx));
+
+    if (((long) sx * bits) % 16 == ((long) dx * bits) % 16)
+    {
+        if (blitter_usable())
+        {
+            copy_hw(src, sx, sy, dst, dy, h, bits, &span, backwards);
+            return 1;
+        }
+
+        copy_sw(src, sx, sy, dst, dy, h, bits, &span, backwards);
+        return 0;
+    }
+
+    /* different bit offsets within a word - only happens for 1 and 8 bpp */
+    {
+        short bpl = 8 / bits;       /* pixels per byte */
+        short step = backwards ? -1 : 1;
+        short line = backwards ? h - 1 : 0;
+
+        for (short n = 0; n < h; n++, line += step)
+        {
+            uint8_t *s = (uint8_t *) line_addr(src, sy + line);
+            uint8_t *d = (uint8_t *) line_addr(dst, dy + line);
+
+            if (bits == 8)
+            {
+                memmove(d + dx, s + sx, w);
+                continue;
+            }
+
+            for (short i = 0; i < w; i++)
+            {
+                short c = backwards ? w - 1 - i : i;
+                short sp = sx + c;
+                short dp = dx + c;
+                uint8_t bit = (s[sp / bpl] >> (7 - sp % 8)) & 1;
+
+                d[dp / bpl] = (d[dp / bpl] & ~(0x80 >> (dp % 8))) | (bit << (7 - dp % 8));
+            }
+        }
+    }
+    return 0;
+}
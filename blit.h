@@ -0,0 +1,22 @@
+/*
+ * blit.h - blitter accelerated rectangle operations
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <stdint.h>
+#include "vram.h"
+
+extern short blit_hw_enable;    /* 0: always use the software path */
+
+int blit_init(void);
+int blit_fill(struct vram_surface *dst, short x, short y, short w, short h, uint32_t color);
+int blit_pattern(struct vram_surface *dst, short x, short y, short w, short h, const uint16_t *pattern);
+int blit_copy(struct vram_surface *src, short sx, short sy,
+              struct vram_surface *dst, short dx, short dy, short w, short h);
+
+#endif /* BLIT_H */
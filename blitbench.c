@@ -0,0 +1,133 @@
+/*
+ * blitbench.c - compare blitter and software rectangle operations
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "blit.h"
+#include "vram.h"
+#include "bench.h"
+#include "fb_video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <osbind.h>
+
+#define BENCH_WIDTH     640
+#define BENCH_HEIGHT    480
+#define BENCH_TICKS     bench_ticks_per_second()    /* run every test for at least a second */
+
+static const short depths[] = { 1, 8, 16, 24 };
+static const short sizes[] = { 16, 64, 256, 0 };    /* 0: the full surface */
+
+#define NUM_DEPTHS  (sizeof(depths) / sizeof(depths[0]))
+#define NUM_SIZES   (sizeof(sizes) / sizeof(sizes[0]))
+
+enum bench_op { BENCH_FILL, BENCH_COPY, NUM_OPS };
+
+static const char * const op_names[NUM_OPS] = { "fill", "copy" };
+
+/* kbytes per second, [op][depth][size][hw] */
+static long result[NUM_OPS][NUM_DEPTHS][NUM_SIZES][2];
+
+static struct vram_surface src_surface;
+static struct vram_surface dst_surface;
+static struct vram_surface * const src = &src_surface;
+static struct vram_surface * const dst = &dst_surface;
+
+/*
+ * run <op> on a <w> x <h> rectangle until BENCH_TICKS have passed, return
+ * the throughput in kbytes/s
+ */
+static long bench(enum bench_op op, short w, short h)
+{
+    long bytes = (long) w * h * fb_pixel_bits(dst->bpp) / 8;
+    long reps = 0;
+    uint32_t start;
+    uint32_t ticks;
+
+    start = bench_ticks();
+    do
+    {
+        if (op == BENCH_FILL)
+            blit_fill(dst, 0, 0, w, h, reps);
+        else
+            blit_copy(src, 0, 0, dst, 0, 0, w, h);
+        reps++;
+    } while ((ticks = bench_ticks() - start) < BENCH_TICKS);
+
+    return (double) bytes * reps * bench_ticks_per_second() / ticks / 1024;
+}
+
+/* runs in supervisor mode, for the blitter registers and the system timer */
+static long run_benchmarks(void)
+{
+    for (short d = 0; d < NUM_DEPTHS; d++)
+    {
+        if (vram_alloc_surface(src, BENCH_WIDTH, BENCH_HEIGHT, depths[d]) != 0)
+            return -1;
+        if (vram_alloc_surface(dst, BENCH_WIDTH, BENCH_HEIGHT, depths[d]) != 0)
+            return -1;
+
+        for (short s = 0; s < NUM_SIZES; s++)
+        {
+            short w = sizes[s] ? sizes[s] : BENCH_WIDTH;
+            short h = sizes[s] ? sizes[s] : BENCH_HEIGHT;
+
+            for (short hw = 0; hw < 2; hw++)
+            {
+                blit_hw_enable = hw;
+                for (short op = 0; op < NUM_OPS; op++)
+                    result[op][d][s][hw] = bench(op, w, h);
+            }
+        }
+
+        vram_free_surface(dst);
+        vram_free_surface(src);
+    }
+    blit_hw_enable = 1;
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (blit_init() != 0)
+        printf("no blitter, both columns show the software path\r\n");
+
+    if (vram_init(2 * vram_surface_size(BENCH_WIDTH, BENCH_HEIGHT, 24)) != 0)
+    {
+        fprintf(stderr, "%s: could not allocate video RAM\r\n", argv[0]);
+        exit(1);
+    }
+
+    if (Supexec(run_benchmarks) != 0)
+    {
+        fprintf(stderr, "%s: could not allocate benchmark surfaces\r\n", argv[0]);
+        vram_exit();
+        exit(1);
+    }
+    vram_exit();
+
+    printf("op   bpp     size   blitter KB/s  software KB/s\r\n");
+    for (short op = 0; op < NUM_OPS; op++)
+        for (short d = 0; d < NUM_DEPTHS; d++)
+            for (short s = 0; s < NUM_SIZES; s++)
+                printf("%-4s %3d %4dx%-4d %13ld %14ld\r\n", op_names[op], depths[d],
+                       sizes[s] ? sizes[s] : BENCH_WIDTH, sizes[s] ? sizes[s] : BENCH_HEIGHT,
+                       result[op][d][s][1], result[op][d][s][0]);
+
+    return 0;
+}
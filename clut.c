@@ -0,0 +1,224 @@
+/*
+ * clut.c - shadowed FireBee colour lookup table
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "clut.h"
+#include "sched.h"
+#include "fb_video.h"
+#include "trace.h"
+#include <stddef.h>
+
+/*
+ * All palette changes go to a shadow copy and only widen the range of dirty
+ * entries. clut_commit() hands that range to a job of the frame scheduler
+ * (sched.c), which uploads it during vertical blank with one long word write
+ * per entry, so palette animation costs a few hundred bus cycles per frame
+ * and never shows up mid-frame.
+ */
+static uint32_t shadow[CLUT_SIZE];
+static const uint8_t *gamma_ramp;
+static short dirty_first = CLUT_SIZE;
+static short dirty_last = -1;
+static volatile short locked;
+static struct sched_job clut_job;
+
+static void mark_dirty(short first, short last)
+{
+    if (first < dirty_first)
+        dirty_first = first;
+    if (last > dirty_last)
+        dirty_last = last;
+}
+
+static void upload(void)
+{
+    const uint8_t *ramp = gamma_ramp;
+    volatile uint32_t *hw = &fb_vd_clut32[dirty_first];
+    uint32_t *sh = &shadow[dirty_first];
+    short count = dirty_last - dirty_first + 1;
+
+    if (ramp == NULL)
+    {
+        while (count-- > 0)
+        {
+            REG_WRITE(*hw, *sh++);
+            hw++;
+        }
+    }
+    else
+    {
+        while (count-- > 0)
+        {
+            uint32_t rgb = *sh++;
+
+            REG_WRITE(*hw, CLUT_RGB(ramp[(rgb >> 16) & 0xff], ramp[(rgb >> 8) & 0xff], ramp[rgb & 0xff]));
+            hw++;
+        }
+    }
+
+    dirty_first = CLUT_SIZE;
+    dirty_last = -1;
+}
+
+static uint32_t clut_job_run(struct sched_job *job, uint32_t budget)
+{
+    /* somebody is just changing the shadow - try again next frame */
+    if (locked)
+        return job->cost;
+
+    if (dirty_last >= 0)
+        upload();
+    return 0;
+}
+
+void clut_set(short index, uint32_t rgb)
+{
+    locked = 1;
+    shadow[index] = rgb;
+    mark_dirty(index, index);
+    locked = 0;
+}
+
+/*
+ * set <count> entries from <first> on from 0x00RRGGBB values
+ */
+void clut_set_range(short first, short count, const uint32_t *rgb)
+{
+    if (count <= 0)
+        return;
+
+    locked = 1;
+    for (short i = 0; i < count; i++)
+        shadow[first + i] = rgb[i];
+    mark_dirty(first, first + count - 1);
+    locked = 0;
+}
+
+uint32_t clut_get(short index)
+{
+    return shadow[index];
+}
+
+static void reverse(short first, short last)
+{
+    while (first < last)
+    {
+        uint32_t tmp = shadow[first];
+
+        shadow[first++] = shadow[last];
+        shadow[last--] = tmp;
+    }
+}
+
+/*
+ * rotate entries <first> to <last> by <step> positions (palette cycling)
+ */
+void clut_cycle(short first, short last, short step)
+{
+    short count = last - first + 1;
+
+    if (count <= 1)
+        return;
+
+    step %= count;
+    if (step < 0)
+        step += count;
+    if (step == 0)
+        return;
+
+    /* rotate right in place by three reversals */
+    locked = 1;
+    reverse(first, last);
+    reverse(first, first + step - 1);
+    reverse(first + step, last);
+    mark_dirty(first, last);
+    locked = 0;
+}
+
+/*
+ * set <count> entries from <first> on to the mix of <from> and <to> at <level>,
+ * 0 (all <from>) to 256 (all <to>)
+ */
+void clut_fade(short first, short count, const uint32_t *from, const uint32_t *to, short level)
+{
+    if (count <= 0)
+        return;
+
+    locked = 1;
+    for (short i = 0; i < count; i++)
+    {
+        uint32_t rgb = 0;
+
+        for (short shift = 0; shift <= 16; shift += 8)
+        {
+            int f = (from[i] >> shift) & 0xff;
+            int t = (to[i] >> shift) & 0xff;
+
+            rgb |= (uint32_t) (f + (((t - f) * level) >> 8)) << shift;
+        }
+        shadow[first + i] = rgb;
+    }
+    mark_dirty(first, first + count - 1);
+    locked = 0;
+}
+
+/*
+ * apply the (precomputed) <ramp> to every colour component on upload. NULL switches
+ * gamma correction off. Takes effect for the whole palette with the next commit
+ */
+void clut_set_gamma(const uint8_t *ramp)
+{
+    locked = 1;
+    gamma_ramp = ramp;
+    mark_dirty(0, CLUT_SIZE - 1);
+    locked = 0;
+}
+
+/*
+ * upload the changed entries during the next vertical blank. Without a VBL
+ * hook, they are uploaded immediately. Needs supervisor mode
+ */
+void clut_commit(void)
+{
+    if (dirty_last < 0)
+        return;
+
+    if (clut_job.func == NULL)
+        sched_job_init(&clut_job, clut_job_run, NULL, SCHED_PRIO_CLUT);
+    sched_submit(&clut_job, (uint32_t) (dirty_last - dirty_first + 1) * SCHED_REG_CYCLES);
+}
+
+/*
+ * upload the changed entries right now (e.g. while video is off)
+ */
+void clut_flush(void)
+{
+    locked = 1;
+    if (dirty_last >= 0)
+        upload();
+    locked = 0;
+}
+
+/*
+ * upload what is still pending right away. Needs supervisor mode
+ */
+void clut_exit(void)
+{
+    sched_cancel(&clut_job);
+    clut_flush();
+}
@@ -0,0 +1,28 @@
+/*
+ * clut.h - shadowed FireBee colour lookup table
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef CLUT_H
+#define CLUT_H
+
+#include <stdint.h>
+
+#define CLUT_SIZE   256
+
+#define CLUT_RGB(r, g, b)   (((uint32_t) (r) << 16) | ((uint32_t) (g) << 8) | (uint32_t) (b))
+
+void clut_set(short index, uint32_t rgb);
+void clut_set_range(short first, short count, const uint32_t *rgb);
+uint32_t clut_get(short index);
+void clut_cycle(short first, short last, short step);
+void clut_fade(short first, short count, const uint32_t *from, const uint32_t *to, short level);
+void clut_set_gamma(const uint8_t *ramp);
+
+void clut_commit(void);
+void clut_flush(void);
+void clut_exit(void);
+
+#endif /* CLUT_H */
@@ -0,0 +1,350 @@
+/*
+ * convert.c - bulk pixel format conversion
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "convert.h"
+#include "convtab.h"
+#include <string.h>
+
+/*
+ * Every conversion goes through 0xAARRGGBB longs: the source is decoded into a
+ * small buffer, which is then encoded into the destination format. The decoder
+ * and encoder are picked once per call, the inner loops only do table lookups,
+ * shifts and masks. Conversions that only move bytes around (same format,
+ * 5-6-5 byte order swap) skip the buffer.
+ *
+ * The 5-6-5 tables come from mkconvtab (convtab.c). Which of the plain and the
+ * byte swapped table produces a given byte order depends on the CPU, so that
+ * is decided here at compile time.
+ */
+#define CHUNK   64
+
+typedef uint32_t long_t __attribute__((may_alias));
+typedef uint16_t word_t __attribute__((may_alias));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BE_R    conv_565_r
+#define BE_G    conv_565_g
+#define BE_B    conv_565_b
+#define LE_R    conv_565s_r
+#define LE_G    conv_565s_g
+#define LE_B    conv_565s_b
+#define PACK2(first, second)    ((uint32_t) (first) << 16 | (second))
+#define LOAD_ARGB(p)            (*(const long_t *) (p))
+#define STORE_ARGB(p, v)        (*(long_t *) (p) = (v))
+#else
+#define BE_R    conv_565s_r
+#define BE_G    conv_565s_g
+#define BE_B    conv_565s_b
+#define LE_R    conv_565_r
+#define LE_G    conv_565_g
+#define LE_B    conv_565_b
+#define PACK2(first, second)    ((uint32_t) (second) << 16 | (first))
+#define LOAD_ARGB(p)            __builtin_bswap32(*(const long_t *) (p))
+#define STORE_ARGB(p, v)        (*(long_t *) (p) = __builtin_bswap32(v))
+#endif
+
+static uint32_t palette[256];
+
+/*
+ * nearest palette entry for every colour with 4 bits per component, for
+ * encoding into PIXFMT_INDEX8
+ */
+static uint8_t inverse[16 * 16 * 16];
+
+static const short pixel_size[PIXFMT_COUNT] = { 1, 2, 2, 3, 4 };
+
+short convert_pixel_size(enum pixel_format fmt)
+{
+    return fmt > PIXFMT_NONE && fmt < PIXFMT_COUNT ? pixel_size[fmt] : 0;
+}
+
+/*
+ * video RAM layout for a video mode
+ */
+enum pixel_format convert_bpp_format(short bpp)
+{
+    switch (bpp)
+    {
+        case 8:
+            return PIXFMT_INDEX8;
+        case 16:
+            return PIXFMT_RGB565;
+        case 24:
+        case 32:
+            return PIXFMT_ARGB8888;
+    }
+    return PIXFMT_NONE;
+}
+
+/*
+ * same for an fVDI mode description, which may ask for Falcon byte order
+ */
+enum pixel_format convert_mode_format(const Mode *mode)
+{
+    if (mode->bpp == 16 && mode->org == 0x81)
+        return PIXFMT_RGB565_LE;
+
+    return convert_bpp_format(mode->bpp);
+}
+
+/*
+ * set the palette used to decode PIXFMT_INDEX8 and rebuild the inverse colour
+ * map for encoding into it. That is a nearest colour search for 4096 colours,
+ * so don't call it for every image
+ */
+void convert_set_palette(const uint32_t *pal, short count)
+{
+    memset(palette, 0, sizeof(palette));
+    for (short i = 0; i < count && i < 256; i++)
+        palette[i] = 0xff000000 | pal[i];
+
+    for (short c = 0; c < 16 * 16 * 16; c++)
+    {
+        long r = ((c >> 8) & 15) * 17;
+        long g = ((c >> 4) & 15) * 17;
+        long b = (c & 15) * 17;
+        long best = 0x7fffffff;
+
+        for (short i = 0; i < count && i < 256; i++)
+        {
+            long dr = r - ((pal[i] >> 16) & 0xff);
+            long dg = g - ((pal[i] >> 8) & 0xff);
+            long db = b - (pal[i] & 0xff);
+            long d = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+
+            if (d < best)
+            {
+                best = d;
+                inverse[c] = i;
+            }
+        }
+    }
+}
+
+/* decoders: <n> source pixels to 0xAARRGGBB */
+
+static void decode_index8(uint32_t *out, const uint8_t *in, short n)
+{
+    for (short i = 0; i < n; i++)
+        out[i] = palette[in[i]];
+}
+
+static void decode_rgb565(uint32_t *out, const uint8_t *in, short n)
+{
+    for (short i = 0; i < n; i++, in += 2)
+        out[i] = conv_565_hi[in[0]] | conv_565_lo[in[1]];
+}
+
+static void decode_rgb565_le(uint32_t *out, const uint8_t *in, short n)
+{
+    for (short i = 0; i < n; i++, in += 2)
+        out[i] = conv_565_hi[in[1]] | conv_565_lo[in[0]];
+}
+
+static void decode_rgb888(uint32_t *out, const uint8_t *in, short n)
+{
+    for (short i = 0; i < n; i++, in += 3)
+        out[i] = 0xff000000 | (uint32_t) in[0] << 16 | (uint32_t) in[1] << 8 | in[2];
+}
+
+static void decode_argb8888(uint32_t *out, const uint8_t *in, short n)
+{
+    if (((uintptr_t) in & 3) == 0)
+    {
+        for (short i = 0; i < n; i++, in += 4)
+            out[i] = LOAD_ARGB(in);
+        return;
+    }
+
+    for (short i = 0; i < n; i++, in += 4)
+        out[i] = (uint32_t) in[0] << 24 | (uint32_t) in[1] << 16 | (uint32_t) in[2] << 8 | in[3];
+}
+
+/* encoders: <n> 0xAARRGGBB pixels to the destination format */
+
+static void encode_index8(uint8_t *out, const uint32_t *in, short n)
+{
+    for (short i = 0; i < n; i++)
+        out[i] = inverse[(in[i] >> 12 & 0xf00) | (in[i] >> 8 & 0xf0) | (in[i] >> 4 & 0xf)];
+}
+
+/* one 5-6-5 pixel through the component tables for the wanted byte order */
+static inline uint16_t pixel_565(uint32_t argb, const uint16_t *r, const uint16_t *g, const uint16_t *b)
+{
+    return r[argb >> 16 & 0xff] | g[argb >> 8 & 0xff] | b[argb & 0xff];
+}
+
+/*
+ * store two pixels with one long write once the destination is long aligned
+ */
+static inline void encode_565(uint8_t *out, const uint32_t *in, short n,
+                              const uint16_t *r, const uint16_t *g, const uint16_t *b)
+{
+    word_t *w = (word_t *) out;
+    long_t *l;
+
+    if ((uintptr_t) out & 1)
+    {
+        for (short i = 0; i < n; i++, out += 2)
+        {
+            uint16_t v = pixel_565(in[i], r, g, b);
+
+            memcpy(out, &v, 2);
+        }
+        return;
+    }
+
+    if ((uintptr_t) w & 2 && n > 0)
+    {
+        *w++ = pixel_565(*in++, r, g, b);
+        n--;
+    }
+
+    l = (long_t *) w;
+    for (; n >= 2; n -= 2, in += 2)
+        *l++ = PACK2(pixel_565(in[0], r, g, b), pixel_565(in[1], r, g, b));
+
+    if (n)
+        *(word_t *) l = pixel_565(in[0], r, g, b);
+}
+
+static void encode_rgb565(uint8_t *out, const uint32_t *in, short n)
+{
+    encode_565(out, in, n, BE_R, BE_G, BE_B);
+}
+
+static void encode_rgb565_le(uint8_t *out, const uint32_t *in, short n)
+{
+    encode_565(out, in, n, LE_R, LE_G, LE_B);
+}
+
+static void encode_rgb888(uint8_t *out, const uint32_t *in, short n)
+{
+    for (short i = 0; i < n; i++, out += 3)
+    {
+        out[0] = in[i] >> 16;
+        out[1] = in[i] >> 8;
+        out[2] = in[i];
+    }
+}
+
+static void encode_argb8888(uint8_t *out, const uint32_t *in, short n)
+{
+    if (((uintptr_t) out & 3) == 0)
+    {
+        for (short i = 0; i < n; i++, out += 4)
+            STORE_ARGB(out, in[i]);
+        return;
+    }
+
+    for (short i = 0; i < n; i++, out += 4)
+    {
+        out[0] = in[i] >> 24;
+        out[1] = in[i] >> 16;
+        out[2] = in[i] >> 8;
+        out[3] = in[i];
+    }
+}
+
+static void (* const decoders[PIXFMT_COUNT])(uint32_t *, const uint8_t *, short) =
+{
+    decode_index8, decode_rgb565, decode_rgb565_le, decode_rgb888, decode_argb8888
+};
+
+static void (* const encoders[PIXFMT_COUNT])(uint8_t *, const uint32_t *, short) =
+{
+    encode_index8, encode_rgb565, encode_rgb565_le, encode_rgb888, encode_argb8888
+};
+
+/* between the two 5-6-5 byte orders, two pixels at a time if aligned */
+static void swap_565(uint8_t *dst, const uint8_t *src, long count)
+{
+    if ((((uintptr_t) dst | (uintptr_t) src) & 3) == 0)
+    {
+        const long_t *s = (const long_t *) src;
+        long_t *d = (long_t *) dst;
+
+        for (; count >= 2; count -= 2)
+        {
+            uint32_t v = *s++;
+
+            *d++ = (v & 0xff00ff00) >> 8 | (v & 0x00ff00ff) << 8;
+        }
+        dst = (uint8_t *) d;
+        src = (const uint8_t *) s;
+    }
+
+    for (; count > 0; count--, dst += 2, src += 2)
+    {
+        uint8_t b = src[0];
+
+        dst[0] = src[1];
+        dst[1] = b;
+    }
+}
+
+/*
+ * convert <count> pixels. Source and destination must not overlap
+ */
+void convert_pixels(void *dst, enum pixel_format dfmt,
+                    const void *src, enum pixel_format sfmt, long count)
+{
+    uint32_t buf[CHUNK];
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    short dsize = convert_pixel_size(dfmt);
+    short ssize = convert_pixel_size(sfmt);
+
+    if (dsize == 0 || ssize == 0)
+        return;
+
+    if (dfmt == sfmt)
+    {
+        memcpy(dst, src, count * dsize);
+        return;
+    }
+
+    if ((dfmt == PIXFMT_RGB565 && sfmt == PIXFMT_RGB565_LE) ||
+        (dfmt == PIXFMT_RGB565_LE && sfmt == PIXFMT_RGB565))
+    {
+        swap_565(dst, src, count);
+        return;
+    }
+
+    while (count > 0)
+    {
+        short n = count > CHUNK ? CHUNK : count;
+
+        decoders[sfmt](buf, s, n);
+        encoders[dfmt](d, buf, n);
+        s += n * ssize;
+        d += n * dsize;
+        count -= n;
+    }
+}
+
+void convert_rect(void *dst, long dpitch, enum pixel_format dfmt,
+                  const void *src, long spitch, enum pixel_format sfmt, short w, short h)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    for (; h > 0; h--, d += dpitch, s += spitch)
+        convert_pixels(d, dfmt, s, sfmt, w);
+}
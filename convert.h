@@ -0,0 +1,39 @@
+/*
+ * convert.h - bulk pixel format conversion
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+#include "fb_video.h"
+
+/*
+ * pixel formats, defined by their byte layout in memory
+ */
+enum pixel_format
+{
+    PIXFMT_NONE = -1,
+    PIXFMT_INDEX8,          /* one byte palette index */
+    PIXFMT_RGB565,          /* rrrrrggg gggbbbbb (Motorola byte order) */
+    PIXFMT_RGB565_LE,       /* gggbbbbb rrrrrggg (Falcon org 0x81, Intel byte order) */
+    PIXFMT_RGB888,          /* R G B */
+    PIXFMT_ARGB8888,        /* A R G B, what 24 bpp video RAM holds (A ignored) */
+    PIXFMT_COUNT
+};
+
+short convert_pixel_size(enum pixel_format fmt);
+enum pixel_format convert_mode_format(const Mode *mode);
+enum pixel_format convert_bpp_format(short bpp);
+
+void convert_set_palette(const uint32_t *palette, short count);
+
+void convert_pixels(void *dst, enum pixel_format dfmt,
+                    const void *src, enum pixel_format sfmt, long count);
+void convert_rect(void *dst, long dpitch, enum pixel_format dfmt,
+                  const void *src, long spitch, enum pixel_format sfmt, short w, short h);
+
+#endif /* CONVERT_H */
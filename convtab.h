@@ -0,0 +1,33 @@
+/*
+ * convtab.h - pixel format conversion tables
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef CONVTAB_H
+#define CONVTAB_H
+
+#include <stdint.h>
+
+/*
+ * generated by mkconvtab at build time (convtab.c).
+ *
+ * conv_565_r/g/b[] map an 8 bit colour component to its share of a 5-6-5
+ * pixel, conv_565s_r/g/b[] the same with the two bytes of the pixel swapped.
+ * ORing the three entries gives the pixel.
+ *
+ * conv_565_hi[] and conv_565_lo[] map the high and low byte of a 5-6-5 pixel
+ * to their share of the 0xAARRGGBB pixel it expands to (components scaled to
+ * the full 0..255 range, alpha 0xff). ORing both entries gives the pixel
+ */
+extern const uint16_t conv_565_r[256];
+extern const uint16_t conv_565_g[256];
+extern const uint16_t conv_565_b[256];
+extern const uint16_t conv_565s_r[256];
+extern const uint16_t conv_565s_g[256];
+extern const uint16_t conv_565s_b[256];
+extern const uint32_t conv_565_hi[256];
+extern const uint32_t conv_565_lo[256];
+
+#endif /* CONVTAB_H */
@@ -0,0 +1,280 @@
+/*
+ * cursor.c - software mouse cursor with save-under
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cursor.h"
+#include "pixel.h"
+#include "vbl.h"
+#include <stddef.h>
+
+/*
+ * The cursor is drawn straight into the displayed screen. Before it is, the
+ * pixels underneath go to a save buffer, and taking the cursor away copies
+ * just that rectangle back, so nothing else ever needs to be redrawn.
+ *
+ * cursor_move() only records the position (it may be called from the mouse
+ * interrupt); the VBL hook below moves the cursor at most once per frame.
+ * Drawing that may touch the cursor is bracketed with cursor_begin() and
+ * cursor_end(), which take the cursor off the screen only if it is in the way.
+ *
+ * With page flipping, flip.c hands each newly displayed buffer over with
+ * cursor_retarget(), which takes the cursor off the old one (it becomes a
+ * draw buffer) and puts it on the new one. In shadow mode, the cursor is
+ * never part of the shadow surface; shadow_present() brackets its copies
+ * like any other drawing.
+ */
+static struct cursor_shape shape;
+static struct vram_surface *target;
+static struct vram_surface save;
+static uint32_t save_buffer[CURSOR_MAX * CURSOR_MAX];      /* 32 bpp worst case */
+
+static volatile short pos_x, pos_y;     /* hot spot */
+static volatile short moved;
+static short hide_level = 1;
+
+static short drawn;                     /* cursor is on <target> at: */
+static short drawn_x, drawn_y;
+static short drawn_w, drawn_h;
+
+static volatile short locked;
+static short vbl_hooked;
+
+/*
+ * copy the save buffer back over the cursor
+ */
+static void restore_background(void)
+{
+    if (!drawn)
+        return;
+
+    pixel_copy_rect(&save, 0, 0, target, drawn_x, drawn_y, drawn_w, drawn_h);
+    drawn = 0;
+}
+
+/*
+ * save what is under the cursor at the current position and draw it
+ */
+static void draw_cursor(void)
+{
+    const struct pixel_ops *ops;
+    short x = pos_x - shape.hot_x;
+    short y = pos_y - shape.hot_y;
+    short sx = 0, sy = 0;
+    short w = shape.width;
+    short h = shape.height;
+
+    moved = 0;
+    if (target == NULL)
+        return;
+
+    /* clip to the screen */
+    if (x < 0)
+    {
+        sx = -x;
+        w += x;
+        x = 0;
+    }
+    if (y < 0)
+    {
+        sy = -y;
+        h += y;
+        y = 0;
+    }
+    if (x + w > target->width)
+        w = target->width - x;
+    if (y + h > target->height)
+        h = target->height - y;
+    if (w <= 0 || h <= 0)
+        return;
+
+    pixel_copy_rect(target, x, y, &save, 0, 0, w, h);
+    drawn = 1;
+    drawn_x = x;
+    drawn_y = y;
+    drawn_w = w;
+    drawn_h = h;
+
+    ops = pixel_ops(target->bpp);
+    for (short row = 0; row < h; row++)
+    {
+        uint8_t *line = (uint8_t *) target->addr + (long) (y + row) * target->pitch;
+        uint32_t mask = shape.mask[sy + row] << sx;
+        uint32_t data = shape.data[sy + row] << sx;
+
+        for (short col = 0; col < w; col++, mask <<= 1, data <<= 1)
+        {
+            if (data & 0x80000000UL)
+                ops->put(line, x + col, shape.fg);
+            else if (mask & 0x80000000UL)
+                ops->put(line, x + col, shape.bg);
+        }
+    }
+}
+
+static void cursor_vbl(void)
+{
+    /* somebody is just changing the cursor - try again next frame */
+    if (locked || !moved || hide_level > 0)
+        return;
+
+    restore_background();
+    draw_cursor();
+}
+
+static void set_target(struct vram_surface *screen)
+{
+    target = screen;
+    save.addr = save_buffer;
+    save.width = CURSOR_MAX;
+    save.height = CURSOR_MAX;
+    save.bpp = screen->bpp;
+    save.pitch = vram_pitch(CURSOR_MAX, screen->bpp);
+    save.size = sizeof(save_buffer);
+}
+
+/*
+ * put the cursor on <screen>. Like the VDI's, it starts out hidden, so a
+ * cursor_show() is needed to make it appear
+ */
+int cursor_init(struct vram_surface *screen)
+{
+    if (!vbl_hooked)
+        vbl_hooked = vbl_install() == 0 && vbl_add(cursor_vbl) == 0;
+
+    if (!vbl_hooked)
+        return -1;
+
+    locked = 1;
+    set_target(screen);
+    drawn = 0;
+    hide_level = 1;
+    locked = 0;
+
+    return 0;
+}
+
+void cursor_exit(void)
+{
+    locked = 1;
+    if (target != NULL)
+        restore_background();
+    target = NULL;
+    locked = 0;
+
+    vbl_del(cursor_vbl);
+    vbl_hooked = 0;
+}
+
+void cursor_set_shape(const struct cursor_shape *new_shape)
+{
+    locked = 1;
+    restore_background();
+    shape = *new_shape;
+    if (shape.width > CURSOR_MAX)
+        shape.width = CURSOR_MAX;
+    if (shape.height > CURSOR_MAX)
+        shape.height = CURSOR_MAX;
+    moved = 1;
+    locked = 0;
+}
+
+/*
+ * move the hot spot to <x>, <y>. The cursor follows at the next vertical blank
+ */
+void cursor_move(short x, short y)
+{
+    pos_x = x;
+    pos_y = y;
+    moved = 1;
+}
+
+/*
+ * hide and show nest, like v_hide_c() and v_show_c()
+ */
+void cursor_hide(void)
+{
+    locked = 1;
+    hide_level++;
+    restore_background();
+    locked = 0;
+}
+
+void cursor_show(void)
+{
+    locked = 1;
+    if (hide_level > 0 && --hide_level == 0)
+    {
+        restore_background();
+        draw_cursor();
+    }
+    locked = 0;
+}
+
+/*
+ * about to draw into <w> x <h> at <x>, <y> of <s>: take the cursor away if it
+ * is in the way. It stays where it is until the matching cursor_end()
+ */
+void cursor_begin(struct vram_surface *s, short x, short y, short w, short h)
+{
+    locked = 1;
+    hide_level++;
+    if (drawn && s == target &&
+        x < drawn_x + drawn_w && drawn_x < x + w &&
+        y < drawn_y + drawn_h && drawn_y < y + h)
+    {
+        restore_background();
+        moved = 1;
+    }
+    locked = 0;
+}
+
+/*
+ * drawing is done. Puts the cursor back right away if cursor_begin() took it away
+ */
+void cursor_end(void)
+{
+    locked = 1;
+    if (hide_level > 0 && --hide_level == 0 && moved)
+    {
+        restore_background();
+        draw_cursor();
+    }
+    locked = 0;
+}
+
+/*
+ * <screen> is displayed from now on (called from flip.c's scheduler job). Returns
+ * -1 if the cursor is just being changed, the caller needs to try again later
+ */
+int cursor_retarget(struct vram_surface *screen)
+{
+    if (target == NULL || screen == target)
+        return 0;
+
+    if (locked)
+        return -1;
+
+    restore_background();
+    set_target(screen);
+    if (hide_level == 0)
+        draw_cursor();
+    else
+        moved = 1;
+
+    return 0;
+}
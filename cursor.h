@@ -0,0 +1,45 @@
+/*
+ * cursor.h - software mouse cursor with save-under
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <stdint.h>
+#include "vram.h"
+
+#define CURSOR_MAX  32      /* maximum width and height */
+
+/*
+ * like a GEM mouse form: where a <data> bit is set, the pixel gets <fg>,
+ * otherwise where a <mask> bit is set it gets <bg>, the rest is transparent.
+ * Bit 31 of each row is the leftmost pixel. <fg> and <bg> are pixel values
+ * of the screen depth
+ */
+struct cursor_shape
+{
+    short width;
+    short height;
+    short hot_x;
+    short hot_y;
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t mask[CURSOR_MAX];
+    uint32_t data[CURSOR_MAX];
+};
+
+/* these need supervisor mode */
+int cursor_init(struct vram_surface *screen);
+void cursor_exit(void);
+void cursor_set_shape(const struct cursor_shape *shape);
+void cursor_move(short x, short y);
+void cursor_hide(void);
+void cursor_show(void);
+void cursor_begin(struct vram_surface *s, short x, short y, short w, short h);
+void cursor_end(void);
+int cursor_retarget(struct vram_surface *screen);
+
+#endif /* CURSOR_H */
@@ -0,0 +1,437 @@
+/*
+ * emu.c - host emulation of the FireBee video hardware
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "emu.h"
+#include "fb_video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+/*
+ * With -DFB_HOST, fb_video.h points the hardware registers here and
+ * sysvars.h does the same with the TOS system variables, so the driver code
+ * runs unchanged on Linux. REG_WRITE() (trace.h) tells us about register
+ * writes we need to react to.
+ *
+ * A timer signal every EMU_TICK_US plays the part of the interrupts: it
+ * advances the 200 Hz system timer, ends simulated PLL busy periods and,
+ * whenever a frame of the programmed timing has passed, runs the VBL queue.
+ * Like a real interrupt, the signal handler suspends the main program, so
+ * the driver's VBL locking works the same way.
+ *
+ * ST RAM is a block aligned to what the video base registers can address,
+ * so the truncated base address written to the VIDEL maps straight back to
+ * host memory. The emulated CPU is the host CPU, so 16 and 32 bit pixels are
+ * in host byte order.
+ */
+volatile uint32_t emu_clut[256];
+volatile uint32_t emu_cntrl;
+volatile uint32_t emu_border;
+volatile uint16_t emu_pll_config;
+volatile int16_t emu_pll_reconfig;
+volatile uint16_t emu_frq;
+volatile struct videl_registers emu_videl;
+
+struct emu_sysvars emu_sysvars;
+
+static void (*vbl_queue[EMU_VBL_QUEUE])(void);
+static volatile uint32_t vbl_count;
+
+static uint8_t *stram;
+static long stram_used;
+static long stram_last;             /* offset of the most recent ST RAM block */
+
+static uint64_t start_us;
+static uint64_t next_vbl_us;
+static uint64_t pll_ready_us;
+static volatile short pll_busy;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * duration of one frame (field for interlace) of the programmed timing
+ */
+static long frame_us(void)
+{
+    long pixel_clock;
+
+    switch ((emu_cntrl >> 8) & FB_CLOCK_MASK)
+    {
+        case FB_CLOCK_25:
+            pixel_clock = 25;
+            break;
+        case FB_CLOCK_33:
+            pixel_clock = 33;
+            break;
+        default:
+            pixel_clock = emu_frq + 1;
+            break;
+    }
+
+    if (emu_videl.hht == 0 || emu_videl.vft == 0)
+        return 1000000 / 60;
+
+    return (long) emu_videl.hht * emu_videl.vft / pixel_clock;
+}
+
+static void emu_tick(int sig)
+{
+    uint64_t now = now_us();
+
+    (void) sig;
+
+    emu_sysvars.hz_200 = (now - start_us) / 5000;
+
+    if (pll_busy && now >= pll_ready_us)
+    {
+        emu_pll_reconfig = 0;
+        pll_busy = 0;
+    }
+
+    if (now >= next_vbl_us)
+    {
+        vbl_count++;
+        for (short i = 0; i < emu_sysvars.nvbls; i++)
+        {
+            if (emu_sysvars.vblqueue[i] != NULL)
+                emu_sysvars.vblqueue[i]();
+        }
+
+        next_vbl_us += frame_us();
+        if (next_vbl_us <= now)
+            next_vbl_us = now + frame_us();
+    }
+}
+
+static void pll_busy_for(long us)
+{
+    pll_ready_us = now_us() + us;
+    emu_pll_reconfig = -1;
+    pll_busy = 1;
+}
+
+/*
+ * called by REG_WRITE() after <reg> has been written
+ */
+void emu_write(volatile void *reg)
+{
+    if (reg == &emu_frq)
+        pll_busy_for(EMU_PLL_READY_US);
+    else if (reg == &emu_pll_reconfig)
+        pll_busy_for(EMU_PLL_RECONFIG_US);
+}
+
+int emu_init(void)
+{
+    struct sigaction sa;
+    struct itimerval timer;
+    void *block;
+
+    if (posix_memalign(&block, 1L << EMU_ADDR_BITS, EMU_STRAM_SIZE) != 0)
+        return -1;
+    stram = block;
+    memset(stram, 0, EMU_STRAM_SIZE);
+    stram_used = 0;
+
+    emu_sysvars.hz_200 = 0;
+    emu_sysvars.nvbls = EMU_VBL_QUEUE;
+    emu_sysvars.vblqueue = vbl_queue;
+
+    start_us = now_us();
+    next_vbl_us = start_us + frame_us();
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = emu_tick;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, NULL);
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = EMU_TICK_US;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    return 0;
+}
+
+void emu_exit(void)
+{
+    struct itimerval timer;
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_REAL, &timer, NULL);
+    signal(SIGALRM, SIG_DFL);
+
+    free(stram);
+    stram = NULL;
+}
+
+/*
+ * Mxalloc(). ST RAM is handed out from the emulated block; only the most
+ * recent ST RAM block is really given back by emu_free(), which is all the
+ * driver's single video RAM arena needs
+ */
+void *emu_alloc(long size, short st)
+{
+    if (!st)
+        return malloc(size);
+
+    size = (size + 15) & ~15L;
+    if (stram == NULL || stram_used + size > EMU_STRAM_SIZE)
+        return NULL;
+
+    stram_last = stram_used;
+    stram_used += size;
+
+    return stram + stram_last;
+}
+
+void emu_free(void *block)
+{
+    uint8_t *p = block;
+
+    if (stram != NULL && p >= stram && p < stram + EMU_STRAM_SIZE)
+    {
+        if (p == stram + stram_last)
+            stram_used = stram_last;
+        return;
+    }
+    free(block);
+}
+
+uint32_t emu_vbl_count(void)
+{
+    return vbl_count;
+}
+
+struct scanout_job
+{
+    pthread_t thread;
+    const uint8_t *base;
+    long pitch;
+    short bits;
+    short hscroll;
+    short y0;
+    short y1;
+    struct emu_frame *frame;
+};
+
+static uint32_t pixel_rgb(const uint8_t *line, long x, short bits)
+{
+    switch (bits)
+    {
+        case 1:
+            return emu_clut[(line[x >> 3] >> (7 - (x & 7))) & 1] & 0xffffff;
+
+        case 8:
+            return emu_clut[line[x]] & 0xffffff;
+
+        case 16:
+        {
+            uint16_t p = ((const uint16_t *) line)[x];
+            uint32_t r = (p >> 11) & 0x1f;
+            uint32_t g = (p >> 5) & 0x3f;
+            uint32_t b = p & 0x1f;
+
+            return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+        }
+
+        default:
+            return ((const uint32_t *) line)[x] & 0xffffff;
+    }
+}
+
+static void *scanout_lines(void *arg)
+{
+    struct scanout_job *job = arg;
+    short width = job->frame->width;
+
+    for (short y = job->y0; y < job->y1; y++)
+    {
+        const uint8_t *line = job->base + y * job->pitch;
+        uint8_t *out = job->frame->rgb + (long) y * width * 3;
+
+        for (short x = 0; x < width; x++)
+        {
+            uint32_t rgb = pixel_rgb(line, x + job->hscroll, job->bits);
+
+            *out++ = rgb >> 16;
+            *out++ = rgb >> 8;
+            *out++ = rgb;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * decode what the programmed base address, depth, timing and CLUT put on
+ * screen into <frame>. frame->rgb is (re)allocated as needed, the caller frees
+ * it. The conversion is split into bands of lines, one thread each.
+ * Returns -1 if the registers don't describe a displayable frame
+ */
+int emu_scanout(struct emu_frame *frame)
+{
+    struct scanout_job jobs[EMU_MAX_THREADS];
+    const volatile struct videl_registers *vr = &emu_videl;
+    sigset_t alarm, old;
+    uint32_t base;
+    long pitch;
+    short bits;
+    short width;
+    short height;
+    long threads;
+
+    switch (emu_cntrl & COLMASK)
+    {
+        case COLOR1:
+            bits = 1;
+            break;
+        case COLOR8:
+            bits = 8;
+            break;
+        case COLOR16:
+            bits = 16;
+            break;
+        case COLOR24:
+            bits = 32;
+            break;
+        default:
+            return -1;
+    }
+
+    if (vr->hde < vr->hdb || vr->vde < vr->vdb)
+        return -1;
+
+    width = vr->hde - vr->hdb + 1;
+    height = vr->vde - vr->vdb + 1;
+    if (vr->vco & VMODE_DOUBLE_SCAN)
+        height /= 2;
+    else if (vr->vco & VMODE_INTERLACE)
+        height *= 2;
+
+    if (vr->vwrap != 0)
+        pitch = vr->vwrap * 2L;
+    else
+        pitch = (((width + 7) & ~7) * bits / 8 + 1) & ~1L;
+
+    base = (((uint32_t) vr->vbasx & 0x3ff) << 16 | (uint32_t) vr->vbasm << 8 | vr->vbasl) &
+           ((1UL << EMU_ADDR_BITS) - 1);
+    if (base + pitch * height > EMU_STRAM_SIZE)
+        return -1;
+
+    if (frame->rgb == NULL || frame->width != width || frame->height != height)
+    {
+        uint8_t *rgb = realloc(frame->rgb, (long) width * height * 3);
+
+        if (rgb == NULL)
+            return -1;
+        frame->rgb = rgb;
+        frame->width = width;
+        frame->height = height;
+    }
+
+    /* video off shows black */
+    if (!(emu_cntrl & FB_VIDEO_ON))
+    {
+        memset(frame->rgb, 0, (long) width * height * 3);
+        return 0;
+    }
+
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > EMU_MAX_THREADS)
+        threads = EMU_MAX_THREADS;
+    if (threads > height)
+        threads = height;
+
+    /* the timer signal belongs to the main program, not to the workers */
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, &old);
+
+    for (short i = 0; i < threads; i++)
+    {
+        struct scanout_job *job = &jobs[i];
+
+        job->base = stram + base;
+        job->pitch = pitch;
+        job->bits = bits;
+        job->hscroll = vr->hscroll & 15;
+        job->y0 = height * i / threads;
+        job->y1 = height * (i + 1) / threads;
+        job->frame = frame;
+
+        if (pthread_create(&job->thread, NULL, scanout_lines, job) != 0)
+        {
+            scanout_lines(job);
+            job->frame = NULL;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    for (short i = 0; i < threads; i++)
+    {
+        if (jobs[i].frame != NULL)
+            pthread_join(jobs[i].thread, NULL);
+    }
+
+    return 0;
+}
+
+/*
+ * write the current screen contents to <name> as a binary PPM
+ */
+int emu_dump_ppm(const char *name)
+{
+    struct emu_frame frame = { 0, 0, NULL };
+    FILE *fp;
+    int ret = 0;
+
+    if (emu_scanout(&frame) != 0)
+        return -1;
+
+    fp = fopen(name, "wb");
+    if (fp == NULL)
+    {
+        free(frame.rgb);
+        return -1;
+    }
+
+    fprintf(fp, "P6\n%d %d\n255\n", frame.width, frame.height);
+    if (fwrite(frame.rgb, 3, (long) frame.width * frame.height, fp) != (size_t) frame.width * frame.height)
+        ret = -1;
+    if (fclose(fp) != 0)
+        ret = -1;
+
+    free(frame.rgb);
+
+    return ret;
+}
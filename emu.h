@@ -0,0 +1,50 @@
+/*
+ * emu.h - host emulation of the FireBee video hardware
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef EMU_H
+#define EMU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EMU_STRAM_SIZE      (14 * 1024 * 1024L)     /* FireBee ST RAM */
+#define EMU_ADDR_BITS       26                      /* what the video base registers hold */
+#define EMU_TICK_US         1000                    /* emulator timer interrupt */
+#define EMU_VBL_QUEUE       8
+#define EMU_PLL_READY_US    100                     /* busy after a new frequency */
+#define EMU_PLL_RECONFIG_US 2000                    /* busy while reconfiguring */
+#define EMU_MAX_THREADS     16                      /* scanout conversion */
+
+struct emu_sysvars
+{
+    volatile uint32_t hz_200;
+    volatile int16_t nvbls;
+    void (** volatile vblqueue)(void);
+};
+
+extern struct emu_sysvars emu_sysvars;
+
+/* a decoded frame, 3 bytes (R, G, B) per pixel */
+struct emu_frame
+{
+    short width;
+    short height;
+    uint8_t *rgb;
+};
+
+int emu_init(void);
+void emu_exit(void);
+void emu_write(volatile void *reg);
+
+void *emu_alloc(long size, short stram);
+void emu_free(void *block);
+
+int emu_scanout(struct emu_frame *frame);
+int emu_dump_ppm(const char *name);
+uint32_t emu_vbl_count(void);
+
+#endif /* EMU_H */
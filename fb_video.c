@@ -19,231 +19,207 @@
 
 #include "fb_video.h"
 #include "modeline.h"
+#include "videl.h"
+#include "modetab.h"
+#include "vram.h"
+#include "clut.h"
+#include "pixel.h"
+#include "modedb.h"
+#include "modesel.h"
+#include "sched.h"
+#include "vbl.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <osbind.h>
 
-static struct res
-{
-    short width;
-    short height;
-    short bpp;
-    short freq;
-} rs[] = {
-    { 320, 240, 8, 130 },
-    { 640, 480, 1, 70 },
-    { 640, 480, 8, 60 },
-    { 640, 480, 16, 70 },
-    { 640, 480, 24, 50 },
-};
+/*
+ * video RAM arena: room for triple buffering plus off-screen surfaces
+ */
+#define NUM_SCREENS     3
+#define OFFSCREEN_VRAM  (256 * 1024L)
 
 const Mode *graphics_mode;
 struct modeline modeline;
 
-static short set_bpp(short bpp)
-{
-    switch (bpp) {
-        case 1:
-            *fb_vd_cntrl &= ~COLMASK;
-            *fb_vd_cntrl |= COLOR1;
-            break;
-        case 8:
-            *fb_vd_cntrl &= ~COLMASK;
-            *fb_vd_cntrl |= COLOR8;
-            break;
-        case 16:
-            *fb_vd_cntrl &= ~COLMASK;
-            *fb_vd_cntrl |= COLOR16;
-            break;
-        case 24:
-            *fb_vd_cntrl &= ~COLMASK;
-            *fb_vd_cntrl |= COLOR24;
-            break;
-        default:
-            break;
-    }
-
-    return bpp;
-}
+static const struct modetab_entry *mode;
 
-static void fbee_set_clockmode(enum fb_clockmode mode)
-{
-    if (!(mode <= FB_CLOCK_PLL))
-    {
-        puts("error: illegal clock mode\r\n");
-        for (;;);
-    }
+#define MODEDB_FILE     "modes.db"
 
-    *fb_vd_cntrl = (*fb_vd_cntrl & ~(FB_CLOCK_MASK)) | mode << 8;
-}
+static struct modedb modedb;
+static struct modetab_entry db_mode;
 
 /*
- * wait for the Firebee clock generator to be idle
+ * stage the precalculated timing from the mode table and let the shadow
+ * code (videl_shadow.c) figure out what needs to be written. Video is only
+ * switched off (and the PLL reprogrammed) if the pixel clock changes
  */
-static void wait_pll(void)
+static void fbee_stage_video(enum fb_vd_vcntrl_fields col, short *screen_address)
 {
-    do {} while (fb_vd_pll_reconfig < 0);   /* wait until video PLL not busy */
-}
-
-/*
- * set the Firebee video (pixel) clock to <clock> MHz.
- */
-void fbee_set_clock(unsigned short clock)
-{
-    fbee_set_clockmode(FB_CLOCK_PLL);
-
-    wait_pll();
-    *fb_vd_frq = clock - 1;
-    wait_pll();
-    *fb_vd_pll_reconfig = 0;
-}
-
-void fbee_set_screen(volatile struct videl_registers *regs, void *adr)
-{
-    regs->vbasx = ((unsigned long) adr >> 16) & 0x3ff;
-    regs->vbasm = ((unsigned long) adr >> 8) & 0xff;
-    regs->vbasl = ((unsigned long) adr);
-}
-
-void set_videl_regs_from_modeline(struct modeline *ml, volatile struct videl_registers *vr)
-{
-    unsigned short left_margin = (ml->h_total - ml->h_display) / 2;
-    unsigned short upper_margin = (ml->v_total - ml->v_display) / 2;
-
-    /*
-     * set and activate FireBee video clock generator
-     */
-    fbee_set_clockmode(FB_CLOCK_PLL);
-    fbee_set_clock(ml->pixel_clock);
-
-    /*
-     * set video mode according to the calculated modeline
-     */
-    vr->hht = ml->h_total;
-    vr->hde = left_margin - 1 + ml->h_display;
-    vr->hbe = left_margin - 1;
-    vr->hdb = left_margin;
-    vr->hbb = left_margin + ml->h_display;
-    vr->hss = ml->h_total - (ml->h_sync_end - ml->h_sync_start);
-
-    vr->vft = ml->v_total;
-    vr->vde = upper_margin + ml->v_display - 1;
-    vr->vbe = upper_margin - 1;
-    vr->vdb = upper_margin;
-    vr->vbb = upper_margin + ml->v_display;
-
-    vr->vss = ml->v_total - (ml->v_sync_end - ml->v_sync_start);
+    videl_stage_timing(&mode->videl, mode->modeline.pixel_clock);
+    videl_stage_scan(videl_scan_bits(&mode->modeline.flags));
+    videl_stage_depth(col);
+    videl_stage_base(screen_address);
+    sched_set_timing(&mode->modeline);
 }
 
 void fbee_set_video(enum fb_vd_vcntrl_fields col, short *screen_address)
 {
-    fbee_set_screen(videl_regs, screen_address);
-
-    /*
-     * disable Falcon shift mode and ST shift mode on the FireBee video side,
-     * disable FireBee video and disable the video DAC -
-     * this will leave you with a black screen and no video at all
-     */
-    *fb_vd_cntrl &= ~(FALCON_SHIFT_MODE | ST_SHIFT_MODE | FB_VIDEO_ON | VIDEO_DAC_ON);
-
-    /* it appears we can only enable FireBee video if we write 0 to ST shift mode
-     * and Falcon shift mode in exactly this sequence
-     *
-     * Don't write to one of these registers once you activated FireBee video as you'll
-     * be set back to Atari video
-     */
-    videl_regs->stsft = 0;
-    videl_regs->spshift = 0;
-    *fb_vd_cntrl &= ~(FALCON_SHIFT_MODE | ST_SHIFT_MODE | FB_VIDEO_ON | VIDEO_DAC_ON);
+    fbee_stage_video(col, screen_address);
 
-    /*
-     * write videl registers with the calculated timing from the modeline
-     */
-    set_videl_regs_from_modeline(&modeline, videl_regs);
-
-    set_bpp(col);
-
-    /*
-     * enable video again once all the settings are done
-     */
-    *fb_vd_cntrl |= FB_VIDEO_ON | VIDEO_DAC_ON;
+    if (videl_commit() < 0)
+        puts("error: video PLL timeout\r\n");
+    videl_commit_wait();
 }
 
 
-static void calc_modeline(struct res *res, struct modeline *ml)
-{
-    /*
-     * round down horizontal resolution to closest multiple of 8. Otherwise we get staircases
-     */
-    res->width &= ~7;
-
-    /*
-     * translate the resolution information into proper
-     * video timing (a modeline)
-     */
-    general_timing_formula(res->width, res->height, res->freq, 0.0, ml);
-}
-
 void *screen_address;
+static struct vram_surface screen;
 
 
 /* Allocate screen buffer */
 static short *fbee_alloc_vram(short width, short height, short depth)
 {
-    void *buffer;
-
     /* FireBee screen buffers live in ST RAM with BaS_gcc */
-    buffer = (void *) Mxalloc((long) width * height * depth + 255, MX_STRAM);
-    if (buffer == NULL)
+    if (vram_init(NUM_SCREENS * vram_surface_size(width, height, depth) + OFFSCREEN_VRAM) != 0)
     {
         fprintf(stderr, "Mxalloc() failed to allocate screen buffer.");
         exit(1);
     }
-    screen_address = (void *) ((((uint32_t) buffer + 255UL) & ~255UL));
+    if (vram_alloc_surface(&screen, width, height, depth) != 0)
+    {
+        fprintf(stderr, "failed to allocate screen surface.");
+        exit(1);
+    }
+    screen_address = screen.addr;
 
-    printf("screen buffer allocated at 0x%lx\r\n", (long) buffer);
+    printf("screen buffer allocated at 0x%lx\r\n", (long) screen_address);
     return screen_address;
 }
 
 static int r;
 
+/*
+ * Initialize Firebee video
+ */
 void video_init(void)
 {
-    screen_address = fbee_alloc_vram(rs[r].width,
-                                     rs[r].height, sizeof(short));
-    fbee_set_video(rs[r].bpp, screen_address + FB_VRAM_PHYS_OFFSET);
+    screen_address = fbee_alloc_vram(mode->width,
+                                     mode->height, mode->bpp);
+    fbee_stage_video(mode->bpp, screen_address + FB_VRAM_PHYS_OFFSET);
+    videl_commit_start();
 
-    /* set CLUT (unsigned char RGB[255][4]) */
+    /* set CLUT while the video PLL settles */
     for (int col = 0; col < 256; col ++)
-    {
-        fb_vd_clut[col][1] = 0xff; fb_vd_clut[col][2] = col; fb_vd_clut[col][3] = 0x0;
-    }
-    /*
-    for (int i = 0; i < rs[r].height; i++)
-        for (int j = 0; j < rs[r].width; j++)
-            ((char **) screen_address) [i][j] = rand() * 255 / RAND_MAX;
-    */
+        clut_set(col, CLUT_RGB(0xff, col, 0x0));
+    clut_flush();
+
+    if (videl_commit_finish() != 0)
+        puts("error: video PLL timeout\r\n");
+
+    /* fresh video RAM contains whatever was there before */
+    pixel_fill_rect(&screen, 0, 0, screen.width, screen.height, 0);
 }
 
+/*
+ * the VBL hooks live in this program, they must not survive it
+ */
+static void video_exit(void)
+{
+    sched_exit();
+    clut_exit();
+    videl_exit();
+    vbl_remove();
+}
 
 /*
- * Initialize Firebee video
+ * GTF timing for a mode that isn't in the mode database. Goes through the
+ * modeline cache (modecache.c), so asking again for the same mode is cheap
  */
+static int calc_mode(short width, short height, short bpp, short refresh, int flags, struct modetab_entry *entry)
+{
+    modeline_lookup(width, height, refresh, flags, &entry->modeline);
+
+    if (entry->modeline.pixel_clock < modesel_config.min_pixel_clock ||
+        entry->modeline.pixel_clock > modesel_config.max_pixel_clock)
+        return -1;
+
+    videl_timing_from_modeline(&entry->modeline, &entry->videl);
+    if (!videl_timing_valid(&entry->videl))
+        return -1;
+
+    entry->width = width;
+    entry->height = height;
+    entry->bpp = bpp;
+    entry->freq = refresh;
+
+    return 0;
+}
+
+/*
+ * look up a <width>x<height>x<bpp>@<refresh>[i|d] specification in the mode
+ * database, or calculate it if it isn't there
+ */
+static const struct modetab_entry *find_db_mode(const char *spec)
+{
+    const struct modedb_record *rec = NULL;
+    short width, height, bpp, refresh;
+    char scan = '\0';
+    int flags;
+
+    if (sscanf(spec, "%hdx%hdx%hd@%hd%c", &width, &height, &bpp, &refresh, &scan) < 4)
+        return NULL;
+    flags = scan == 'i' ? 1 : scan == 'd' ? -1 : 0;
+
+    if (modedb_load(&modedb, MODEDB_FILE) == 0)
+    {
+        rec = modedb_find(&modedb, width, height, bpp, refresh, flags);
+        if (rec != NULL)
+            modedb_entry(&modedb, rec, &db_mode);
+        modedb_free(&modedb);
+    }
+    else
+        fprintf(stderr, "could not load mode database %s\r\n", MODEDB_FILE);
+
+    if (rec == NULL)
+    {
+        printf("%s is not in %s, calculating GTF timing\r\n", spec, MODEDB_FILE);
+        if (calc_mode(width, height, bpp, refresh, flags, &db_mode) != 0)
+        {
+            fprintf(stderr, "%s can't be displayed\r\n", spec);
+            exit(1);
+        }
+    }
+
+    return &db_mode;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc > 1) {
+    if (argc > 1 && (mode = find_db_mode(argv[1])) == NULL) {
         r = atoi(argv[1]);
-    } else {
-        fprintf(stderr, "usage: %s <res number (0 to %ld)>\r\n", argv[0], sizeof(rs) / sizeof(rs[0]));
+    }
+    if (argc <= 1 || (mode == NULL && (r < 0 || r >= modetab_size))) {
+        fprintf(stderr, "usage: %s <res number (0 to %d)> | <width>x<height>x<bpp>@<refresh>[i|d]\r\n",
+                argv[0], modetab_size - 1);
         exit(1);
     }
 
+    /*
+     * the modeline is precalculated at build time (see mkmodes.c), comes from
+     * the mode database (see mkmodedb.c) or is calculated (see calc_mode())
+     */
+    if (mode == NULL)
+        mode = &modetab[r];
+    modeline = mode->modeline;
 
-    calc_modeline(&rs[r], &modeline);
-
-    printf("%d x %d x %d@%d\r\n", modeline.h_display, modeline.v_display, rs[r].bpp, modeline.pixel_clock + 1);
+    printf("%d x %d x %d@%d\r\n", modeline.h_display, modeline.v_display, mode->bpp, modeline.pixel_clock + 1);
     fflush(stdout);
     Supexec(video_init);
+    Supexec(video_exit);
+#ifdef FB_TRACE
+    trace_report();
+#endif
 
     return 0;
 }
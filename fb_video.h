@@ -150,7 +150,7 @@ enum fb_vd_vcntrl_fields
     VIDEO_DAC_ON = (1UL << 1),
     FB_VIDEO_ON = (1UL << 0)
 };
-const uint32_t COLMASK = (COLOR1 | COLOR8 | COLOR16 | COLOR24);
+static const uint32_t COLMASK = (COLOR1 | COLOR8 | COLOR16 | COLOR24);
 
 enum fb_clockmode
 {
@@ -177,6 +177,16 @@ enum falcon_vco_bits
     VCO_HZ_OFFS = (1 << 8),         /* Hz base offset: 0 = 128 cycles (ST res), 1 = 64 cycles (all others) */
 };
 
+/*
+ * video mode register (struct videl_registers.vco, 0xffff82c2)
+ */
+enum falcon_vmode_bits
+{
+    VMODE_DOUBLE_SCAN = (1 << 0),   /* every line is displayed twice */
+    VMODE_INTERLACE = (1 << 1),     /* odd and even lines in alternating fields */
+    VMODE_SCAN_MASK = VMODE_DOUBLE_SCAN | VMODE_INTERLACE,
+};
+
 typedef struct _MBits {
 	const char *red;
 	const char *green;
@@ -196,6 +206,14 @@ typedef struct _Mode {
 	short org;		/* 1 (usual bit order), 0x81 (Falcon 5+6+5 bit order, but Intel byte order), ? */
 } Mode;
 
+/*
+ * number of bits a pixel occupies in video RAM. 24 bpp true colour is stored as 32 bit xRGB
+ */
+static inline short fb_pixel_bits(short bpp)
+{
+    return bpp == 24 ? 32 : bpp;
+}
+
 extern const Mode *graphics_mode;
 #define FB_VRAM_PHYS_OFFSET       0x40000000            /* FireBee video ram (MMU-mapped to ST RAM) has a phys offset into FPGA RAM */
 
@@ -205,14 +223,46 @@ extern void *screen_address;
 extern struct blitter_registers blitter;
 extern struct falcon_busctrl busctrl;
 
-volatile uint8_t (* const fb_vd_clut)[4]  = (volatile uint8_t (* const)[4]) 0xf0000000;
-volatile uint32_t * const fb_vd_cntrl = (volatile uint32_t * const ) 0xf0000400;
-volatile uint32_t * const fb_vd_border = (uint32_t * const ) 0xf0000404;;
+#ifdef FB_HOST
+/*
+ * host build: the registers are plain memory the emulator (emu.c) interprets
+ */
+extern volatile uint32_t emu_clut[256];
+extern volatile uint32_t emu_cntrl;
+extern volatile uint32_t emu_border;
+extern volatile uint16_t emu_pll_config;
+extern volatile int16_t emu_pll_reconfig;
+extern volatile uint16_t emu_frq;
+extern volatile struct videl_registers emu_videl;
+
+static volatile uint32_t * const fb_vd_clut32 = emu_clut;
+static volatile uint32_t * const fb_vd_cntrl = &emu_cntrl;
+static volatile uint32_t * const fb_vd_border = &emu_border;
+
+static volatile uint16_t * const fb_vd_pll_config = &emu_pll_config;
+static volatile int16_t * const fb_vd_pll_reconfig = &emu_pll_reconfig;
+static volatile uint16_t * const fb_vd_frq = &emu_frq;
+static volatile struct videl_registers * const videl_regs = &emu_videl;
+#else
+static volatile uint8_t (* const fb_vd_clut)[4]  = (volatile uint8_t (* const)[4]) 0xf0000000;
+static volatile uint32_t * const fb_vd_clut32 = (volatile uint32_t * const) 0xf0000000;     /* same, as 0x00RRGGBB longs */
+static volatile uint32_t * const fb_vd_cntrl = (volatile uint32_t * const ) 0xf0000400;
+static volatile uint32_t * const fb_vd_border = (uint32_t * const ) 0xf0000404;;
   
-volatile uint16_t * const fb_vd_pll_config = (volatile uint16_t * const ) 0xf0000600;
-volatile int16_t * const fb_vd_pll_reconfig = (volatile int16_t * const ) 0xf0000800 ;
-volatile uint16_t * const fb_vd_frq = (volatile uint16_t * const ) 0xf0000604;
-volatile struct videl_registers * const videl_regs = (volatile struct videl_registers * const ) 0xffff8200;
+static volatile uint16_t * const fb_vd_pll_config = (volatile uint16_t * const ) 0xf0000600;
+static volatile int16_t * const fb_vd_pll_reconfig = (volatile int16_t * const ) 0xf0000800 ;
+static volatile uint16_t * const fb_vd_frq = (volatile uint16_t * const ) 0xf0000604;
+static volatile struct videl_registers * const videl_regs = (volatile struct videl_registers * const ) 0xffff8200;
+#endif
+
+/* pll.c */
+int fbee_set_clock(unsigned short clock);
+
+/* videl.c */
+void fbee_set_screen(volatile struct videl_registers *regs, void *adr);
+
+/* fb_video.c */
+void fbee_set_video(enum fb_vd_vcntrl_fields col, short *screen_address);
 
 
 #endif /* FB_VIDEO_H */
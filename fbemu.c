@@ -0,0 +1,629 @@
+/*
+ * fbemu.c - set video modes and draw on the host hardware emulator
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "emu.h"
+#include "modetab.h"
+#include "videl.h"
+#include "vram.h"
+#include "vbl.h"
+#include "clut.h"
+#include "pixel.h"
+#include "sched.h"
+#include "flip.h"
+#include "cursor.h"
+#include "shadow.h"
+#include "fb_video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Sets the modes of modetab.c (all of them, or the numbers given) through
+ * the same VIDEL shadow code the driver uses, draws colour bars and writes
+ * what the emulated scanout shows to <prefix><width>x<height>x<bpp>.ppm.
+ * Then clears the screen through the frame scheduler (sched.c) and checks
+ * that the scanout is all black afterwards. Last, checks the mouse cursor
+ * (cursor.c) on its own, with shadow_present() (shadow.c) and across a flip,
+ * and page flipping (flip.c) with two and three buffers against the scanout.
+ * Reports how long each mode switch and each scanout conversion took and how
+ * many frames the clear was spread over.
+ *
+ * usage: fbemu [-o <prefix>] [<res number> ...]
+ */
+#define NUM_BARS    8
+#define CURSOR_SIZE 16
+
+static const uint32_t bars[NUM_BARS] =
+{
+    CLUT_RGB(0xff, 0xff, 0xff), CLUT_RGB(0xff, 0xff, 0x00), CLUT_RGB(0x00, 0xff, 0xff), CLUT_RGB(0x00, 0xff, 0x00),
+    CLUT_RGB(0xff, 0x00, 0xff), CLUT_RGB(0xff, 0x00, 0x00), CLUT_RGB(0x00, 0x00, 0xff), CLUT_RGB(0x00, 0x00, 0x00)
+};
+
+static long elapsed_us(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/*
+ * pixel value of bar <i> in <bpp>
+ */
+static uint32_t bar_color(short i, short bpp)
+{
+    uint32_t rgb = bars[i];
+
+    switch (bpp)
+    {
+        case 1:
+            return i & 1;
+        case 8:
+            return i;
+        case 16:
+            return ((rgb >> 8) & 0xf800) | ((rgb >> 5) & 0x07e0) | ((rgb >> 3) & 0x001f);
+        default:
+            return rgb;
+    }
+}
+
+/*
+ * what the scanout shows for bar <i> in <bpp>
+ */
+static uint32_t bar_rgb(short i, short bpp)
+{
+    if (bpp == 1)
+        return bars[i & 1 ? NUM_BARS - 1 : 0];
+    return bars[i];
+}
+
+/*
+ * does <frame> show <rgb> at <x>, <y>? The bars are made of 0x00 and 0xff
+ * components, so only the top bit of each is compared: that is what every
+ * depth keeps for sure
+ */
+static int frame_pixel_is(const struct emu_frame *frame, short x, short y, uint32_t rgb)
+{
+    const uint8_t *p = frame->rgb + ((long) y * frame->width + x) * 3;
+
+    return ((p[0] ^ (rgb >> 16)) & 0x80) == 0 && ((p[1] ^ (rgb >> 8)) & 0x80) == 0 && ((p[2] ^ rgb) & 0x80) == 0;
+}
+
+static int frame_rect_is(const struct emu_frame *frame, short x, short y, short w, short h, uint32_t rgb)
+{
+    for (short row = y; row < y + h; row++)
+        for (short col = x; col < x + w; col++)
+            if (!frame_pixel_is(frame, col, row, rgb))
+                return 0;
+    return 1;
+}
+
+/*
+ * does the scanout show <rgb> all over?
+ */
+static int scanout_is(struct emu_frame *frame, uint32_t rgb)
+{
+    if (emu_scanout(frame) != 0)
+        return 0;
+
+    return frame_rect_is(frame, 0, 0, frame->width, frame->height, rgb);
+}
+
+static void fill(struct vram_surface *s, short i)
+{
+    pixel_fill_rect(s, 0, 0, s->width, s->height, bar_color(i, s->bpp));
+}
+
+static int check(int ok, const char *what)
+{
+    if (!ok)
+        printf("FAILED: %s\n", what);
+    return !ok;
+}
+
+static void draw_bars(struct vram_surface *s)
+{
+    for (short i = 0; i < NUM_BARS; i++)
+    {
+        short x0 = s->width * i / NUM_BARS;
+        short x1 = s->width * (i + 1) / NUM_BARS;
+
+        pixel_fill_rect(s, x0, 0, x1 - x0, s->height, bar_color(i, s->bpp));
+    }
+}
+
+/*
+ * clear <s> to black from the VBL queue, wait for it and check the scanout.
+ * Returns the number of frames it took, -1 if something is left
+ */
+static long clear_screen(struct vram_surface *s, struct emu_frame *frame)
+{
+    static struct sched_clear clear;
+    uint32_t frames = emu_vbl_count();
+    long bytes;
+
+    sched_clear(&clear, s, bar_color(NUM_BARS - 1, s->bpp));
+    sched_wait(&clear.job);
+    frames = emu_vbl_count() - frames;
+
+    if (emu_scanout(frame) != 0)
+        return -1;
+
+    bytes = (long) frame->width * frame->height * 3;
+    for (long i = 0; i < bytes; i++)
+        if (frame->rgb[i] != 0)
+            return -1;
+
+    return frames;
+}
+
+/*
+ * a checkerboard of bar 0 and the last bar: it can't be mistaken for a fill at
+ * any depth
+ */
+static void make_cursor(struct cursor_shape *shape, short bpp)
+{
+    memset(shape, 0, sizeof(*shape));
+    shape->width = CURSOR_SIZE;
+    shape->height = CURSOR_SIZE;
+    shape->fg = bar_color(0, bpp);
+    shape->bg = bar_color(NUM_BARS - 1, bpp);
+
+    for (short row = 0; row < CURSOR_SIZE; row++)
+    {
+        shape->mask[row] = 0xffff0000UL;
+        shape->data[row] = row & 1 ? 0x55550000UL : 0xaaaa0000UL;
+    }
+}
+
+/*
+ * does <frame> show the cursor with its top left corner at <x>, <y>?
+ */
+static int frame_shows_cursor(const struct emu_frame *frame, short x, short y, short bpp)
+{
+    for (short row = 0; row < CURSOR_SIZE; row++)
+    {
+        for (short col = 0; col < CURSOR_SIZE; col++)
+        {
+            short i = (row + col) & 1 ? NUM_BARS - 1 : 0;
+
+            if (!frame_pixel_is(frame, x + col, y + row, bar_rgb(i, bpp)))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * is the <w> x <h> rectangle at <x>, <y> of <frame> the same as in <ref>?
+ */
+static int frame_rect_same(const struct emu_frame *frame, const struct emu_frame *ref,
+                           short x, short y, short w, short h)
+{
+    for (short row = y; row < y + h; row++)
+    {
+        long offset = ((long) row * frame->width + x) * 3;
+
+        if (memcmp(frame->rgb + offset, ref->rgb + offset, (long) w * 3) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * is the <w> x <h> rectangle at <x>, <y> of <s> all pixel value <color>?
+ */
+static int surface_is(struct vram_surface *s, short x, short y, short w, short h, uint32_t color)
+{
+    for (short row = y; row < y + h; row++)
+        for (short col = x; col < x + w; col++)
+            if (pixel_get(s, col, row) != color)
+                return 0;
+    return 1;
+}
+
+/*
+ * cursor_move() takes effect from the cursor's VBL hook; give it a whole frame
+ */
+static void wait_cursor(void)
+{
+    vbl_wait();
+    vbl_wait();
+}
+
+/*
+ * the cursor on <screen> (displayed, showing the colour bars): where it moved
+ * away from, the saved background is back. Returns the number of failed checks
+ */
+static int check_cursor_move(struct vram_surface *screen, struct emu_frame *frame,
+                             const struct cursor_shape *shape, short x0, short y0, short x1, short y1)
+{
+    struct emu_frame ref = { 0, 0, NULL };
+    int failed = 0;
+
+    if (emu_scanout(&ref) != 0)
+        return check(0, "cursor: no scanout");
+
+    cursor_init(screen);
+    cursor_set_shape(shape);
+    cursor_move(x0, y0);
+    cursor_show();
+    wait_cursor();
+    failed += check(emu_scanout(frame) == 0 && frame_shows_cursor(frame, x0, y0, screen->bpp),
+                    "cursor: not shown");
+
+    cursor_move(x1, y1);
+    wait_cursor();
+    failed += check(emu_scanout(frame) == 0 && frame_shows_cursor(frame, x1, y1, screen->bpp),
+                    "cursor: didn't move");
+    failed += check(frame_rect_same(frame, &ref, x0, y0, CURSOR_SIZE, CURSOR_SIZE),
+                    "cursor: old position doesn't show the saved background");
+
+    cursor_exit();
+    free(ref.rgb);
+
+    return failed;
+}
+
+/*
+ * shadow_present() over a visible cursor: the cursor stays on the screen and
+ * out of the shadow surface, and once it is hidden the screen is exactly what
+ * was presented - first all of it, then a rectangle that cuts through the
+ * cursor. Returns the number of failed checks
+ */
+static int check_cursor_shadow(struct vram_surface *screen, struct emu_frame *frame,
+                               const struct cursor_shape *shape, short x, short y)
+{
+    struct vram_surface *s;
+    short bpp = screen->bpp;
+    int failed = 0;
+
+    if (shadow_init(screen->width, screen->height, bpp) != 0)
+        return check(0, "shadow: shadow_init()");
+    s = shadow_surface();
+
+    cursor_init(screen);
+    cursor_set_shape(shape);
+    cursor_move(x, y);
+    cursor_show();
+    wait_cursor();
+
+    /* a new target gets the whole screen */
+    fill(s, 2);
+    shadow_present(screen);
+    failed += check(emu_scanout(frame) == 0 && frame_shows_cursor(frame, x, y, bpp),
+                    "shadow: cursor gone after shadow_present()");
+    failed += check(surface_is(s, 0, 0, s->width, s->height, bar_color(2, bpp)),
+                    "shadow: cursor pixels in the shadow surface");
+    cursor_hide();
+    failed += check(scanout_is(frame, bar_rgb(2, bpp)),
+                    "shadow: cursor pixels in the presented screen");
+
+    cursor_show();
+    pixel_fill_rect(s, x + 5, y - 4, 3 * CURSOR_SIZE, CURSOR_SIZE, bar_color(5, bpp));
+    shadow_damage(x + 5, y - 4, 3 * CURSOR_SIZE, CURSOR_SIZE);
+    shadow_present(screen);
+    failed += check(emu_scanout(frame) == 0 && frame_shows_cursor(frame, x, y, bpp),
+                    "shadow: cursor gone after a partial shadow_present()");
+    failed += check(surface_is(s, x, y, 5, CURSOR_SIZE, bar_color(2, bpp)) &&
+                    surface_is(s, x, y + CURSOR_SIZE - 4, CURSOR_SIZE, 4, bar_color(2, bpp)) &&
+                    surface_is(s, x + 5, y - 4, 3 * CURSOR_SIZE, CURSOR_SIZE, bar_color(5, bpp)),
+                    "shadow: cursor pixels in the shadow surface after a partial shadow_present()");
+    cursor_hide();
+    failed += check(emu_scanout(frame) == 0 &&
+                    frame_rect_is(frame, x, y + CURSOR_SIZE - 4, CURSOR_SIZE, 4, bar_rgb(2, bpp)) &&
+                    frame_rect_is(frame, x, y - 4, 5, CURSOR_SIZE, bar_rgb(2, bpp)) &&
+                    frame_rect_is(frame, x + 5, y - 4, 3 * CURSOR_SIZE, CURSOR_SIZE, bar_rgb(5, bpp)),
+                    "shadow: cursor pixels in the screen after a partial shadow_present()");
+
+    cursor_exit();
+    shadow_exit();
+
+    return failed;
+}
+
+/*
+ * the cursor follows a flip over to the new display buffer and leaves the old
+ * one clean. Returns the number of failed checks
+ */
+static int check_cursor_flip(const struct modetab_entry *m, struct emu_frame *frame,
+                             const struct cursor_shape *shape, short x, short y)
+{
+    struct vram_surface *old;
+    int failed = 0;
+
+    if (flip_init(2, m->width, m->height, m->bpp) != 0)
+        return check(0, "cursor: flip_init()");
+
+    old = flip_display_buffer();
+    fill(old, 2);
+    fill(flip_draw_buffer(), 5);
+
+    cursor_init(old);
+    cursor_set_shape(shape);
+    cursor_move(x, y);
+    cursor_show();
+    wait_cursor();
+
+    flip_swap();
+    flip_wait();
+    failed += check(emu_scanout(frame) == 0 && frame_shows_cursor(frame, x, y, m->bpp) &&
+                    frame_rect_is(frame, 0, 0, frame->width, y, bar_rgb(5, m->bpp)),
+                    "cursor: didn't follow the flip");
+    failed += check(surface_is(old, x, y, CURSOR_SIZE, CURSOR_SIZE, bar_color(2, m->bpp)),
+                    "cursor: left behind in the old display buffer");
+
+    cursor_exit();
+    flip_exit();
+
+    return failed;
+}
+
+/*
+ * the mouse cursor on <screen> (displayed). Returns the number of failed checks
+ */
+static int check_cursor(const struct modetab_entry *m, struct vram_surface *screen, struct emu_frame *frame)
+{
+    struct cursor_shape shape;
+    short x0 = screen->width / NUM_BARS - CURSOR_SIZE / 2;     /* across the first two bars */
+    short x1 = screen->width / 2 + 3;
+    short y1 = screen->height / 2 + 5;
+    int failed = 0;
+
+    make_cursor(&shape, screen->bpp);
+    draw_bars(screen);
+
+    failed += check_cursor_move(screen, frame, &shape, x0, 16, x1, y1);
+    failed += check_cursor_shadow(screen, frame, &shape, x1, y1);
+    failed += check_cursor_flip(m, frame, &shape, x1, y1);
+
+    return failed;
+}
+
+/*
+ * two buffers: the draw buffer is never on screen, and once a flip is done the
+ * scanout shows what was swapped in. Returns the number of failed checks
+ */
+static int check_double_buffer(struct emu_frame *frame, short bpp)
+{
+    int failed = 0;
+
+    for (short n = 0; n < 4; n++)
+    {
+        struct vram_surface *draw = flip_draw_buffer();
+        short i = n & 1 ? NUM_BARS - 1 : 0;
+
+        failed += check(draw != flip_display_buffer(), "double buffering: drawing into the displayed buffer");
+        fill(draw, i);
+        failed += check(flip_swap() != flip_display_buffer(), "double buffering: new draw buffer is displayed");
+        flip_wait();
+        failed += check(flip_display_buffer() == draw, "double buffering: swapped buffer isn't displayed");
+        failed += check(scanout_is(frame, bar_rgb(i, bpp)), "double buffering: scanout doesn't show the swapped buffer");
+    }
+    return failed;
+}
+
+/*
+ * three buffers: flip_swap() doesn't wait for the vertical blank, a frame that
+ * was never shown is dropped and its buffer drawn into next, and once a flip is
+ * done the scanout shows the last buffer swapped in. Returns the number of
+ * failed checks
+ */
+static int check_triple_buffer(struct emu_frame *frame, short bpp)
+{
+    struct vram_surface *queued;
+    struct vram_surface *shown;
+    struct vram_surface *next;
+    uint32_t frames;
+    int failed = 0;
+
+    /* waiting would take a vertical blank per swap */
+    frames = emu_vbl_count();
+    for (short n = 0; n < 3; n++)
+        flip_swap();
+    failed += check(emu_vbl_count() - frames <= 1, "triple buffering: flip_swap() waited for the vertical blank");
+
+    /* two swaps within one frame; if a vertical blank got in between, try again */
+    for (short tries = 0; tries < 10; tries++)
+    {
+        flip_wait();
+        queued = flip_draw_buffer();
+        fill(queued, 0);
+
+        frames = emu_vbl_count();
+        shown = flip_swap();
+        fill(shown, NUM_BARS - 1);
+        next = flip_swap();
+        if (emu_vbl_count() == frames)
+            break;
+    }
+    failed += check(next == queued, "triple buffering: dropped frame didn't return the still queued buffer");
+
+    flip_wait();
+    failed += check(flip_display_buffer() == shown, "triple buffering: last swapped buffer isn't displayed");
+    failed += check(scanout_is(frame, bar_rgb(NUM_BARS - 1, bpp)),
+                    "triple buffering: scanout doesn't show the last swapped buffer");
+
+    return failed;
+}
+
+/*
+ * page flipping with two and three buffers. Returns the number of failed checks
+ */
+static int check_flip(const struct modetab_entry *m, struct emu_frame *frame)
+{
+    int failed = 0;
+
+    for (short count = 2; count <= FLIP_MAX_BUFFERS; count++)
+    {
+        if (flip_init(count, m->width, m->height, m->bpp) != 0)
+        {
+            failed += check(0, "flip_init()");
+            continue;
+        }
+
+        if (count == 2)
+            failed += check_double_buffer(frame, m->bpp);
+        else
+            failed += check_triple_buffer(frame, m->bpp);
+
+        flip_exit();
+    }
+    return failed;
+}
+
+static int show_mode(const struct modetab_entry *m, const char *prefix)
+{
+    struct vram_surface screen;
+    struct emu_frame frame = { 0, 0, NULL };
+    struct timespec start;
+    char name[256];
+    long switch_us;
+    long scanout_us;
+    long clear_frames;
+    int cursor_failed;
+    int flip_failed;
+    int ret;
+
+    if (vram_alloc_surface(&screen, m->width, m->height, m->bpp) != 0)
+        return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    videl_stage_timing(&m->videl, m->modeline.pixel_clock);
+    videl_stage_scan(videl_scan_bits(&m->modeline.flags));
+    videl_stage_depth(m->bpp);
+    videl_stage_base((char *) screen.addr + FB_VRAM_PHYS_OFFSET);
+    sched_set_timing(&m->modeline);
+    ret = videl_commit_start();
+
+    /* palette and picture while the PLL settles */
+    if (m->bpp == 1)
+    {
+        clut_set(0, bars[0]);
+        clut_set(1, bars[NUM_BARS - 1]);
+    }
+    else
+        clut_set_range(0, NUM_BARS, bars);
+    clut_flush();
+    draw_bars(&screen);
+
+    if (ret == 1)
+        ret = videl_commit_finish();
+    else
+        videl_commit_wait();
+    switch_us = elapsed_us(&start);
+
+    if (ret != 0)
+    {
+        vram_free_surface(&screen);
+        return -1;
+    }
+
+    /* let a frame pass with the new settings */
+    vbl_wait();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ret = emu_scanout(&frame);
+    scanout_us = elapsed_us(&start);
+
+    snprintf(name, sizeof(name), "%s%dx%dx%d.ppm", prefix, m->width, m->height, m->bpp);
+    if (ret == 0)
+        ret = emu_dump_ppm(name);
+
+    clear_frames = clear_screen(&screen, &frame);
+    cursor_failed = check_cursor(m, &screen, &frame);
+    flip_failed = check_flip(m, &frame);
+    free(frame.rgb);
+
+    printf("%4dx%-4d %2d bpp @%3d Hz: mode switch %6ld us, scanout %6ld us, clear %3ld frames, cursor %s, flip %s -> %s\n",
+           m->width, m->height, m->bpp, m->freq, switch_us, scanout_us, clear_frames,
+           cursor_failed ? "FAILED" : "ok", flip_failed ? "FAILED" : "ok", ret == 0 ? name : "failed");
+    if (clear_frames < 0 || cursor_failed || flip_failed)
+        ret = -1;
+
+    vram_free_surface(&screen);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *prefix = "";
+    long screen_size = 0;
+    int first = 1;
+    int failed = 0;
+
+    if (argc > 2 && strcmp(argv[1], "-o") == 0)
+    {
+        prefix = argv[2];
+        first = 3;
+    }
+
+    for (short i = 0; i < modetab_size; i++)
+    {
+        long size = vram_surface_size(modetab[i].width, modetab[i].height, modetab[i].bpp);
+
+        if (size > screen_size)
+            screen_size = size;
+    }
+
+    /* the screen plus the page flipping buffers */
+    if (emu_init() != 0 || vram_init(screen_size * (1 + FLIP_MAX_BUFFERS)) != 0)
+    {
+        fprintf(stderr, "%s: could not set up the emulated ST RAM\n", argv[0]);
+        exit(1);
+    }
+
+    if (vbl_install() != 0)
+    {
+        fprintf(stderr, "%s: no free VBL slot\n", argv[0]);
+        exit(1);
+    }
+
+    if (first >= argc)
+    {
+        for (short i = 0; i < modetab_size; i++)
+            failed |= show_mode(&modetab[i], prefix) != 0;
+    }
+    else
+    {
+        for (int i = first; i < argc; i++)
+        {
+            int r = atoi(argv[i]);
+
+            if (r < 0 || r >= modetab_size)
+            {
+                fprintf(stderr, "%s: no mode %d (0 to %d)\n", argv[0], r, modetab_size - 1);
+                failed = 1;
+                continue;
+            }
+            failed |= show_mode(&modetab[r], prefix) != 0;
+        }
+    }
+
+    sched_exit();
+    clut_exit();
+    videl_exit();
+    vbl_remove();
+    vram_exit();
+    emu_exit();
+
+    return failed;
+}
@@ -0,0 +1,156 @@
+/*
+ * flip.c - VBL synchronized page flipping
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "flip.h"
+#include "sched.h"
+#include "cursor.h"
+#include "fb_video.h"
+#include "videl.h"
+#include <stddef.h>
+
+/*
+ * Rendering goes to the draw buffer. flip_swap() queues it for display, the
+ * base address registers are only written from a job of the frame scheduler
+ * (sched.c), so the switch never happens in the middle of a frame.
+ *
+ * With two buffers, the next draw buffer is the one still on screen, so
+ * flip_swap() has to wait for the pending flip to happen. With three, there
+ * is always a buffer that is neither displayed nor queued; a flip that is
+ * still pending when the next one comes in is simply replaced (the frame is
+ * dropped), so the CPU never waits.
+ */
+static struct vram_surface buffers[FLIP_MAX_BUFFERS];
+static short num_buffers;
+static short draw;
+static volatile short displayed;
+static volatile short pending = -1;
+static volatile short locked;
+static struct sched_job flip_job;
+
+/* the base address registers plus restoring, saving and drawing the cursor a line at a time */
+#define FLIP_COST       ((3 + 3 * CURSOR_MAX) * SCHED_REG_CYCLES)
+
+static uint32_t flip_job_run(struct sched_job *job, uint32_t budget)
+{
+    /* flip_swap() is just changing pending - try again next frame */
+    if (locked)
+        return job->cost;
+
+    if (pending >= 0)
+    {
+        /* the mouse cursor moves over to the new screen */
+        if (cursor_retarget(&buffers[pending]) != 0)
+            return job->cost;
+
+        videl_write_base((char *) buffers[pending].addr + FB_VRAM_PHYS_OFFSET);
+        displayed = pending;
+        pending = -1;
+    }
+    return 0;
+}
+
+/*
+ * allocate <count> (2 or 3) screen buffers from the video RAM arena and display the
+ * first one. Needs supervisor mode
+ */
+int flip_init(short count, short width, short height, short bpp)
+{
+    if (count < 2 || count > FLIP_MAX_BUFFERS)
+        return -1;
+
+    for (num_buffers = 0; num_buffers < count; num_buffers++)
+    {
+        if (vram_alloc_surface(&buffers[num_buffers], width, height, bpp) != 0)
+        {
+            flip_exit();
+            return -1;
+        }
+    }
+
+    displayed = 0;
+    pending = -1;
+    draw = 1;
+    videl_write_base((char *) buffers[displayed].addr + FB_VRAM_PHYS_OFFSET);
+    sched_job_init(&flip_job, flip_job_run, NULL, SCHED_PRIO_FLIP);
+
+    return 0;
+}
+
+/*
+ * drop a flip that didn't happen yet and free the buffers. Needs supervisor mode
+ */
+void flip_exit(void)
+{
+    sched_cancel(&flip_job);
+    pending = -1;
+
+    while (num_buffers > 0)
+        vram_free_surface(&buffers[--num_buffers]);
+}
+
+struct vram_surface *flip_draw_buffer(void)
+{
+    return &buffers[draw];
+}
+
+struct vram_surface *flip_display_buffer(void)
+{
+    return &buffers[displayed];
+}
+
+/*
+ * queue the draw buffer for display at the next vertical blank and return the
+ * buffer to draw the next frame into. Needs supervisor mode
+ */
+struct vram_surface *flip_swap(void)
+{
+    short queued;
+    short next;
+
+    if (num_buffers == 2)
+    {
+        flip_wait();        /* don't draw into what is still on screen */
+        next = displayed;   /* read before the flip job can change it */
+        pending = draw;
+        draw = next;
+        sched_submit(&flip_job, FLIP_COST);
+        flip_wait();
+        return &buffers[draw];
+    }
+
+    locked = 1;
+    queued = pending;
+    pending = draw;
+
+    /* an unshown frame is dropped, otherwise take the buffer that is neither displayed nor queued */
+    next = queued >= 0 ? queued : 3 - displayed - draw;
+    locked = 0;
+    sched_submit(&flip_job, FLIP_COST);
+
+    draw = next;
+    return &buffers[draw];
+}
+
+/*
+ * wait until a queued flip has happened
+ */
+void flip_wait(void)
+{
+    do {} while (pending >= 0);
+}
@@ -0,0 +1,22 @@
+/*
+ * flip.h - VBL synchronized page flipping
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef FLIP_H
+#define FLIP_H
+
+#include "vram.h"
+
+#define FLIP_MAX_BUFFERS    3
+
+int flip_init(short buffers, short width, short height, short bpp);
+void flip_exit(void);
+struct vram_surface *flip_draw_buffer(void);
+struct vram_surface *flip_display_buffer(void);
+struct vram_surface *flip_swap(void);
+void flip_wait(void);
+
+#endif /* FLIP_H */
@@ -0,0 +1,295 @@
+/*
+ * gtf_fixed.c - integer only implementation of the VESA general timing formula
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modeline.h"
+#include <stdio.h>
+
+/*
+ * This is the same worksheet as general_timing_formula() in modeline.c, but without
+ * any floating point. Every GTF intermediate is a rational number with small
+ * denominators, so we carry numerator and denominator as 64 bit integers and only
+ * divide (with the same rounding the double version uses) where the worksheet rounds.
+ *
+ * The only irrational step is the square root in the pixel clock driven branch. It is
+ * done with an integer square root in Q10, which is far below the resolution the
+ * following rounding to character cells needs.
+ */
+
+const struct display_fixed gtf_default_display =
+{
+    .CharacterCell = 8,
+    .PClockStep = 0,
+    .HSyncPercent = 8,
+    .M = 600,
+    .C = 40,
+    .K = 128,
+    .J = 20,
+    .VFrontPorch = 1,
+    .VBackPorchPlusSync = 550,
+    .VSyncWidth = 3,
+    .VBackPorch = 6,
+    .Margin = 0,
+    .HBlankingTicks = 160,
+    .HSyncTicks = 32,
+    .VBlankingTime = 460
+};
+
+/*
+ * (int) (n / d + 0.5) - exactly what round() in modeline.c does, including
+ * truncation towards zero for negative values
+ */
+static long long div_round(long long n, long long d)
+{
+    if (d < 0)
+    {
+        n = -n;
+        d = -d;
+    }
+    return (2 * n + d) / (2 * d);
+}
+
+/* round to the nearest even number of lines for doublescan modes */
+static long long div_round_lines(long long n, long long d, int Flags)
+{
+    if (Flags < 0)
+        return div_round(n, 2 * d) * 2;
+
+    return div_round(n, d);
+}
+
+static unsigned long long isqrt(unsigned long long x)
+{
+    unsigned long long res = 0;
+    unsigned long long bit = 1ULL << 62;
+
+    while (bit > x)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (x >= res + bit)
+        {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+            res >>= 1;
+        bit >>= 2;
+    }
+    return res;
+}
+
+/*
+ * horizontal blanking in pixels for an ideal duty cycle of idc_n / idc_d percent
+ */
+static long long blanking_pixels(long long HActive, long long idc_n, long long idc_d, int CharacterCell)
+{
+    if (idc_n < 20 * idc_d)
+        return (HActive / (8 * CharacterCell)) * 2 * CharacterCell;
+
+    return div_round(HActive * idc_n, (100 * idc_d - idc_n) * 2 * CharacterCell) * 2 * CharacterCell;
+}
+
+void general_timing_formula_fixed(const struct display_fixed *Display, int HRes, int VRes, long Clock, int Flags,
+                                  struct modeline *modeline)
+{
+    int CharacterCell = Display->CharacterCell;
+    long long VFrontPorch;
+    long long VSyncWidth;
+    long long VBackPorch;
+
+    /* M and C with the K scaling factor applied, both scaled by 256 */
+    long long Mn = (long long) Display->K * Display->M;
+    long long Cn = (long long) (Display->C - Display->J) * Display->K + 256LL * Display->J;
+
+    long long TopMargin = 0;
+    long long LeftMargin = 0;
+    long long HActive;
+    long long VLines2;              /* active lines, margins, front porch and interlace, times two */
+    long long VSyncPlusBackPorch;
+    long long VTotal2;              /* total number of lines, times two */
+    long long idc_n, idc_d;         /* ideal duty cycle in % is idc_n / idc_d */
+    long long HorizontalBlankingPixels;
+    long long HTotal;
+    long long HSyncWidth;
+    long long HBackPorch;
+    long PClock;                    /* pixel clock in Hz */
+    long long n, d;
+
+    modeline->flags.double_scan = 0;
+    modeline->flags.interlace = 0;
+
+    if (CharacterCell < 1)
+    {
+        printf("Error:  character cell less than 1 pixel.\n");
+        CharacterCell = 1;
+    }
+
+    if (Flags < 0) // if doublescan mode
+    {
+        VFrontPorch = (Display->VFrontPorch + 1) / 2 * 2;
+        VSyncWidth = (Display->VSyncWidth + 1) / 2 * 2;
+        VBackPorch = (Display->VBackPorch + 1) / 2 * 2;
+    }
+    else
+    {
+        VFrontPorch = Display->VFrontPorch;
+        VSyncWidth = Display->VSyncWidth;
+        VBackPorch = Display->VBackPorch;
+    }
+
+    /* number of lines per field */
+    if (Flags > 0)  // if interlace mode
+        VRes = (VRes + 1) / 2;
+    else if (Flags < 0)  // if doublescan mode
+        VRes = VRes * 2;
+
+    /* number of pixels per line rounded to nearest character cell */
+    HRes = div_round(HRes, CharacterCell) * CharacterCell;
+
+    if (Display->Margin > 0)
+    {
+        TopMargin = div_round((long long) Display->Margin * VRes, 100);
+        LeftMargin = div_round((long long) HRes * Display->Margin, 100LL * CharacterCell) * CharacterCell;
+    }
+
+    HActive = HRes + 2 * LeftMargin;
+    VLines2 = 2 * (VRes + 2 * TopMargin + VFrontPorch) + (Flags > 0 ? 1 : 0);
+
+    if (Clock < 1000)
+    {
+        /*
+         * refresh rate driven. The worksheet's horizontal period collapses to
+         * 1000000 / (RefreshRate * VTotal) us
+         */
+        long long RefreshRate = Flags > 0 ? 2 * Clock : Clock;
+
+        n = (long long) Display->VBackPorchPlusSync * RefreshRate * VLines2;
+        d = 2 * (1000000LL - (long long) Display->VBackPorchPlusSync * RefreshRate);
+        VSyncPlusBackPorch = d != 0 ? div_round_lines(n, d, Flags) : 0;
+        if (VSyncPlusBackPorch < VSyncWidth + VBackPorch)
+            VSyncPlusBackPorch = VSyncWidth + VBackPorch;
+
+        VTotal2 = VLines2 + 2 * VSyncPlusBackPorch;
+
+        idc_n = Cn * RefreshRate * VTotal2 - 2000 * Mn;
+        idc_d = 256 * RefreshRate * VTotal2;
+        HorizontalBlankingPixels = blanking_pixels(HActive, idc_n, idc_d, CharacterCell);
+        HTotal = HActive + HorizontalBlankingPixels;
+
+        n = HTotal * RefreshRate * VTotal2;     /* pixel clock in Hz, times two */
+        d = 2;
+    }
+    else if (Clock < 100000)
+    {
+        /* horizontal frequency driven */
+        VSyncPlusBackPorch = div_round_lines((long long) Display->VBackPorchPlusSync * Clock, 1000000, Flags);
+        if (VSyncPlusBackPorch < VSyncWidth + VBackPorch)
+            VSyncPlusBackPorch = VSyncWidth + VBackPorch;
+
+        VTotal2 = VLines2 + 2 * VSyncPlusBackPorch;
+
+        idc_n = Cn * Clock - 1000 * Mn;
+        idc_d = 256LL * Clock;
+        HorizontalBlankingPixels = blanking_pixels(HActive, idc_n, idc_d, CharacterCell);
+        HTotal = HActive + HorizontalBlankingPixels;
+
+        n = HTotal * Clock;
+        d = 1;
+    }
+    else
+    {
+        /* pixel clock driven */
+        long long S2;
+
+        PClock = Clock;
+        if (Display->PClockStep > 0)
+            PClock = PClock / (Display->PClockStep * 1000L) * (Display->PClockStep * 1000L);
+
+        /*
+         * sqrt((100 - C)^2 + 0.4 * M * HActive / PClock) in Q10. HActive gets the
+         * margins added a second time, as in the double version
+         */
+        S2 = (25600 - Cn) * (25600 - Cn) * 16 +
+             4096 * 400000LL * Mn * (HActive + 2 * LeftMargin) / PClock;
+        idc_n = 4 * Cn + 102400 - (long long) isqrt(S2);
+        idc_d = 2048;
+        HorizontalBlankingPixels = blanking_pixels(HActive, idc_n, idc_d, CharacterCell);
+        HTotal = HActive + HorizontalBlankingPixels;
+
+        VSyncPlusBackPorch = div_round_lines((long long) Display->VBackPorchPlusSync * PClock,
+                                             HTotal * 1000000, Flags);
+        if (VSyncPlusBackPorch < VSyncWidth + VBackPorch)
+            VSyncPlusBackPorch = VSyncWidth + VBackPorch;
+
+        VTotal2 = VLines2 + 2 * VSyncPlusBackPorch;
+
+        n = PClock;
+        d = 1;
+    }
+
+    if (Clock < 100000)
+    {
+        if (Display->PClockStep > 0)
+            PClock = n / (d * Display->PClockStep * 1000L) * (Display->PClockStep * 1000L);
+        else
+            PClock = n / d;
+    }
+
+    /* calculate horizontal sync width in pixels */
+    HSyncWidth = div_round((long long) Display->HSyncPercent * HTotal, 100LL * CharacterCell) * CharacterCell;
+
+    /* calculate horizontal back porch in pixels */
+    HBackPorch = HorizontalBlankingPixels / 2;
+
+    VBackPorch = VSyncPlusBackPorch - VSyncWidth;
+
+    modeline->pixel_clock = (int) (PClock / 1000000L);
+    modeline->h_display = HRes;
+    modeline->h_sync_start = (int) (HTotal - HBackPorch - HSyncWidth);
+    modeline->h_sync_end = (int) (HTotal - HBackPorch);
+    modeline->h_total = (int) HTotal;
+
+    if (Flags > 0)  // if interlace mode
+    {
+        modeline->flags.interlace = 1;
+        modeline->v_display = VRes * 2;
+        modeline->v_sync_start = (int) (VTotal2 - 2 * VSyncPlusBackPorch);
+        modeline->v_sync_end = (int) (VTotal2 - 2 * VBackPorch);
+        modeline->v_total = (int) VTotal2;
+    }
+    else if (Flags < 0)  // if doublescan mode
+    {
+        modeline->flags.double_scan = 1;
+        modeline->v_display = VRes / 2;
+        modeline->v_sync_start = (int) ((VTotal2 / 2 - VSyncPlusBackPorch) / 2);
+        modeline->v_sync_end = (int) ((VTotal2 / 2 - VBackPorch) / 2);
+        modeline->v_total = (int) (VTotal2 / 4);
+    }
+    else
+    {
+        modeline->v_display = VRes;
+        modeline->v_sync_start = (int) (VTotal2 / 2 - VSyncPlusBackPorch);
+        modeline->v_sync_end = (int) (VTotal2 / 2 - VBackPorch);
+        modeline->v_total = (int) (VTotal2 / 2);
+    }
+
+    modeline->flags.hsync_polarity = 0;
+    modeline->flags.vsync_polarity = 1;
+}
@@ -0,0 +1,320 @@
+/*
+ * gtftest.c - compare the integer GTF with the floating point one
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Sweeps width, height, Clock (refresh rate, horizontal frequency and pixel
+ * clock driven) and Flags (progressive, interlace, doublescan) over
+ * general_timing_formula() and general_timing_formula_fixed() with the default
+ * display parameters and fails if the modelines differ.
+ *
+ * The only differences allowed are exact rounding boundaries: a worksheet
+ * value that is exactly k + 0.5 (or, for the pixel clock, exactly a whole
+ * number of MHz) is exact in the integer version, while the double version
+ * lands just below or above it and rounds the other way. Such a mismatch is
+ * counted and let through only if redoing the rounding steps as exact
+ * fractions finds a tie at a step that explains every field that differs,
+ * and the integer modeline is the exact one:
+ *
+ *  - v_*: the vertical sync plus back porch lines (the half-line case)
+ *  - h_*: the horizontal blanking pixels or the horizontal sync width
+ *  - pixel clock alone: the truncation to whole MHz
+ *
+ * With the refresh rate driven branch, the sync plus back porch feeds the
+ * blanking and both feed the pixel clock, so an earlier tie explains the later
+ * fields. The pixel clock driven branch uses an integer square root, it can't
+ * have an exact tie in the horizontal timing.
+ *
+ * usage: gtftest [-v]     (-v lists the boundary cases)
+ */
+struct sweep
+{
+    long min, max, step;
+};
+
+static const struct sweep widths = { 320, 2048, 16 };
+static const struct sweep heights = { 200, 1600, 8 };
+static const struct sweep clocks[] =
+{
+    { 50, 100, 5 },                     /* refresh rate */
+    { 30000, 100000, 10000 },           /* horizontal frequency */
+    { 25000000, 200000000, 50000000 }   /* pixel clock */
+};
+
+#define NUM_RANGES  (sizeof(clocks) / sizeof(clocks[0]))
+
+enum branch { REFRESH, HFREQ, PCLOCK };
+
+/* n / d is exactly halfway between two integers */
+static int half_tie(long long n, long long d)
+{
+    return (2 * n) % (2 * d) == d;
+}
+
+/* same rounding as gtf_fixed.c */
+static long long div_round(long long n, long long d)
+{
+    return (2 * n + d) / (2 * d);
+}
+
+/*
+ * vertical sync plus back porch lines as n / d, before rounding. <HTotal> is
+ * only used by the pixel clock branch, where it comes before the vertical timing
+ */
+static void sync_back_porch(const struct display_fixed *dsp, enum branch b, long Clock, int Flags,
+                            long long VLines2, long long HTotal, long long *n, long long *d)
+{
+    long long RefreshRate = Flags > 0 ? 2 * Clock : Clock;
+
+    switch (b)
+    {
+        case REFRESH:
+            *n = (long long) dsp->VBackPorchPlusSync * RefreshRate * VLines2;
+            *d = 2 * (1000000LL - (long long) dsp->VBackPorchPlusSync * RefreshRate);
+            break;
+        case HFREQ:
+            *n = (long long) dsp->VBackPorchPlusSync * Clock;
+            *d = 1000000;
+            break;
+        default:
+            *n = (long long) dsp->VBackPorchPlusSync * Clock;
+            *d = HTotal * 1000000;
+            break;
+    }
+
+    /* doublescan rounds to an even number of lines */
+    if (Flags < 0)
+        *d *= 2;
+}
+
+#define DIFF_V      1
+#define DIFF_H      2
+#define DIFF_CLOCK  4
+
+/*
+ * redo the rounding steps of the worksheet for <HRes> x <VRes>, <Clock>, <Flags>
+ * as exact fractions. Fills the timing into <exact> and returns the exact ties
+ * found as a mask of the fields they can change. The horizontal timing of the
+ * pixel clock driven branch can't be done exactly, it is taken from <fixed>
+ */
+static int find_ties(const struct display_fixed *dsp, enum branch b, int HRes, int VRes, long Clock, int Flags,
+                     const struct modeline *fixed, struct modeline *exact)
+{
+    int cell = dsp->CharacterCell;
+    long long RefreshRate = Flags > 0 ? 2 * Clock : Clock;
+    long long Mn = (long long) dsp->K * dsp->M;
+    long long Cn = (long long) (dsp->C - dsp->J) * dsp->K + 256LL * dsp->J;
+    long long VFrontPorch = Flags < 0 ? (dsp->VFrontPorch + 1) / 2 * 2 : dsp->VFrontPorch;
+    long long VSyncWidth = Flags < 0 ? (dsp->VSyncWidth + 1) / 2 * 2 : dsp->VSyncWidth;
+    long long VBackPorch = Flags < 0 ? (dsp->VBackPorch + 1) / 2 * 2 : dsp->VBackPorch;
+    long long VLines2;
+    long long VSyncPlusBackPorch;
+    long long VTotal2;
+    long long HTotal;
+    long long HBlanking;
+    long long HSyncWidth;
+    long long idc_n, idc_d;
+    long long n, d;
+    int ties = 0;
+
+    *exact = *fixed;
+
+    if (Flags > 0)
+        VRes = (VRes + 1) / 2;
+    else if (Flags < 0)
+        VRes *= 2;
+    HRes = div_round(HRes, cell) * cell;
+    VLines2 = 2 * (VRes + VFrontPorch) + (Flags > 0 ? 1 : 0);
+
+    /* vertical sync plus back porch, the half-line case */
+    if (b == PCLOCK)
+        sync_back_porch(dsp, b, Clock, Flags, VLines2, fixed->h_total, &n, &d);
+    else
+        sync_back_porch(dsp, b, Clock, Flags, VLines2, 0, &n, &d);
+    if (half_tie(n, d))
+        ties |= b == REFRESH ? DIFF_V | DIFF_H | DIFF_CLOCK : DIFF_V;
+    VSyncPlusBackPorch = div_round(n, d) * (Flags < 0 ? 2 : 1);
+    if (VSyncPlusBackPorch < VSyncWidth + VBackPorch)
+        VSyncPlusBackPorch = VSyncWidth + VBackPorch;
+    VTotal2 = VLines2 + 2 * VSyncPlusBackPorch;
+
+    if (b != PCLOCK)
+    {
+        if (b == REFRESH)
+        {
+            idc_n = Cn * RefreshRate * VTotal2 - 2000 * Mn;
+            idc_d = 256 * RefreshRate * VTotal2;
+        }
+        else
+        {
+            idc_n = Cn * Clock - 1000 * Mn;
+            idc_d = 256LL * Clock;
+        }
+
+        /* horizontal blanking, only rounded above 20 % duty cycle */
+        if (idc_n < 20 * idc_d)
+            HBlanking = (HRes / (8 * cell)) * 2 * cell;
+        else
+        {
+            n = HRes * idc_n;
+            d = (100 * idc_d - idc_n) * 2 * cell;
+            if (half_tie(n, d))
+                ties |= DIFF_H | DIFF_CLOCK;
+            HBlanking = div_round(n, d) * 2 * cell;
+        }
+        HTotal = HRes + HBlanking;
+
+        /* pixel clock in Hz as n / d, truncated to whole MHz */
+        if (b == REFRESH)
+        {
+            n = HTotal * RefreshRate * VTotal2;
+            d = 2;
+        }
+        else
+        {
+            n = HTotal * Clock;
+            d = 1;
+        }
+        if (n % (d * 1000000) == 0)
+            ties |= DIFF_CLOCK;
+
+        n = (long long) dsp->HSyncPercent * HTotal;
+        d = 100LL * cell;
+        if (half_tie(n, d))
+            ties |= DIFF_H;
+        HSyncWidth = div_round(n, d) * cell;
+
+        exact->pixel_clock = (int) (HTotal * (b == REFRESH ? RefreshRate * VTotal2 / 2 : Clock) / 1000000);
+        exact->h_display = HRes;
+        exact->h_sync_start = (int) (HTotal - HBlanking / 2 - HSyncWidth);
+        exact->h_sync_end = (int) (HTotal - HBlanking / 2);
+        exact->h_total = (int) HTotal;
+    }
+
+    VBackPorch = VSyncPlusBackPorch - VSyncWidth;
+    if (Flags > 0)
+    {
+        exact->v_sync_start = (int) (VTotal2 - 2 * VSyncPlusBackPorch);
+        exact->v_sync_end = (int) (VTotal2 - 2 * VBackPorch);
+        exact->v_total = (int) VTotal2;
+    }
+    else if (Flags < 0)
+    {
+        exact->v_sync_start = (int) ((VTotal2 / 2 - VSyncPlusBackPorch) / 2);
+        exact->v_sync_end = (int) ((VTotal2 / 2 - VBackPorch) / 2);
+        exact->v_total = (int) (VTotal2 / 4);
+    }
+    else
+    {
+        exact->v_sync_start = (int) (VTotal2 / 2 - VSyncPlusBackPorch);
+        exact->v_sync_end = (int) (VTotal2 / 2 - VBackPorch);
+        exact->v_total = (int) (VTotal2 / 2);
+    }
+
+    return ties;
+}
+
+static int differences(const struct modeline *a, const struct modeline *b)
+{
+    int diff = 0;
+
+    if (a->v_display != b->v_display || a->v_sync_start != b->v_sync_start ||
+        a->v_sync_end != b->v_sync_end || a->v_total != b->v_total ||
+        a->flags.interlace != b->flags.interlace || a->flags.double_scan != b->flags.double_scan)
+        diff |= DIFF_V;
+    if (a->h_display != b->h_display || a->h_sync_start != b->h_sync_start ||
+        a->h_sync_end != b->h_sync_end || a->h_total != b->h_total)
+        diff |= DIFF_H;
+    if (a->pixel_clock != b->pixel_clock)
+        diff |= DIFF_CLOCK;
+
+    return diff;
+}
+
+static void print_modeline(const char *name, const struct modeline *ml)
+{
+    printf("  %-6s %3d  %4d %4d %4d %4d  %4d %4d %4d %4d%s\n", name, ml->pixel_clock,
+           ml->h_display, ml->h_sync_start, ml->h_sync_end, ml->h_total,
+           ml->v_display, ml->v_sync_start, ml->v_sync_end, ml->v_total,
+           ml->flags.interlace ? " interlace" : ml->flags.double_scan ? " doublescan" : "");
+}
+
+int main(int argc, char *argv[])
+{
+    const struct display_fixed *dsp = &gtf_default_display;
+    int verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    long cases = 0;
+    long ties = 0;
+    long failed = 0;
+
+    for (int Flags = -1; Flags <= 1; Flags++)
+    {
+        for (long HRes = widths.min; HRes <= widths.max; HRes += widths.step)
+        {
+            for (long VRes = heights.min; VRes <= heights.max; VRes += heights.step)
+            {
+                for (enum branch b = REFRESH; b < NUM_RANGES; b++)
+                {
+                    for (long Clock = clocks[b].min; Clock <= clocks[b].max; Clock += clocks[b].step)
+                    {
+                        struct modeline ref;
+                        struct modeline fixed;
+                        struct modeline exact;
+                        int diff;
+
+                        memset(&ref, 0, sizeof(ref));
+                        memset(&fixed, 0, sizeof(fixed));
+                        general_timing_formula(HRes, VRes, Clock, Flags, &ref);
+                        general_timing_formula_fixed(dsp, HRes, VRes, Clock, Flags, &fixed);
+                        cases++;
+
+                        diff = differences(&ref, &fixed);
+                        if (diff == 0)
+                            continue;
+
+                        /* only exact ties may differ, and there the integer result is the exact one */
+                        if ((diff & ~find_ties(dsp, b, HRes, VRes, Clock, Flags, &fixed, &exact)) == 0 &&
+                            differences(&fixed, &exact) == 0)
+                        {
+                            ties++;
+                            if (!verbose)
+                                continue;
+                            printf("boundary: %ldx%ld, Clock %ld, Flags %d\n", HRes, VRes, Clock, Flags);
+                        }
+                        else
+                        {
+                            failed++;
+                            printf("MISMATCH: %ldx%ld, Clock %ld, Flags %d\n", HRes, VRes, Clock, Flags);
+                        }
+                        print_modeline("double", &ref);
+                        print_modeline("fixed", &fixed);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%ld cases, %ld on an exact rounding boundary, %ld mismatches\n", cases, ties, failed);
+
+    return failed != 0;
+}
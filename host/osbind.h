@@ -0,0 +1,36 @@
+/*
+ * osbind.h - the GEMDOS/XBIOS calls the driver uses, for host builds on
+ * top of the hardware emulator (emu.c)
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef OSBIND_H
+#define OSBIND_H
+
+#include "emu.h"
+
+#define MX_STRAM        0
+#define MX_TTRAM        1
+#define MX_PREFSTRAM    2
+#define MX_PREFTTRAM    3
+
+static inline long Mxalloc(long amount, short mode)
+{
+    return (long) emu_alloc(amount, mode == MX_STRAM || mode == MX_PREFSTRAM);
+}
+
+static inline long Mfree(void *block)
+{
+    emu_free(block);
+    return 0;
+}
+
+/* there is no user mode to leave on the host */
+static inline long Supexec(long (*func)(void))
+{
+    return func();
+}
+
+#endif /* OSBIND_H */
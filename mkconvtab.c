@@ -0,0 +1,92 @@
+/*
+ * mkconvtab.c - generate the pixel format conversion tables (host tool)
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* see convtab.h for what the tables contain */
+
+static uint16_t swap16(uint16_t v)
+{
+    return (v << 8) | (v >> 8);
+}
+
+/* scale a 5 or 6 bit component to 8 bits, so that full intensity stays full */
+static uint32_t expand(uint32_t v, int bits)
+{
+    return (v << (8 - bits)) | (v >> (2 * bits - 8));
+}
+
+static void emit16(const char *name, uint16_t (*f)(int))
+{
+    printf("const uint16_t %s[256] =\n{", name);
+    for (int i = 0; i < 256; i++)
+        printf("%s0x%04x,", i % 8 ? " " : "\n    ", f(i));
+    printf("\n};\n\n");
+}
+
+static void emit32(const char *name, uint32_t (*f)(int))
+{
+    printf("const uint32_t %s[256] =\n{", name);
+    for (int i = 0; i < 256; i++)
+        printf("%s0x%08lx,", i % 4 ? " " : "\n    ", (unsigned long) f(i));
+    printf("\n};\n\n");
+}
+
+static uint16_t r565(int c) { return (c >> 3) << 11; }
+static uint16_t g565(int c) { return (c >> 2) << 5; }
+static uint16_t b565(int c) { return c >> 3; }
+static uint16_t r565s(int c) { return swap16(r565(c)); }
+static uint16_t g565s(int c) { return swap16(g565(c)); }
+static uint16_t b565s(int c) { return swap16(b565(c)); }
+
+/* high byte: rrrrrggg, low byte: gggbbbbb */
+static uint32_t hi565(int c)
+{
+    uint32_t r = c >> 3;
+    uint32_t g = (c & 7) << 3;
+
+    /* the low bits of the expanded green only depend on the top green bits */
+    return 0xff000000 | expand(r, 5) << 16 | (g << 2 | g >> 4) << 8;
+}
+
+static uint32_t lo565(int c)
+{
+    uint32_t g = c >> 5;
+    uint32_t b = c & 31;
+
+    return g << 2 << 8 | expand(b, 5);
+}
+
+int main(void)
+{
+    printf("/* generated by mkconvtab - do not edit */\n\n");
+    printf("#include \"convtab.h\"\n\n");
+
+    emit16("conv_565_r", r565);
+    emit16("conv_565_g", g565);
+    emit16("conv_565_b", b565);
+    emit16("conv_565s_r", r565s);
+    emit16("conv_565s_g", g565s);
+    emit16("conv_565s_b", b565s);
+    emit32("conv_565_hi", hi565);
+    emit32("conv_565_lo", lo565);
+
+    return 0;
+}
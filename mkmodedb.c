@@ -0,0 +1,482 @@
+/*
+ * mkmodedb.c - sweep the FireBee video mode space into a mode database (host tool)
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modeline.h"
+#include "videl.h"
+#include "modesel.h"
+#include "modedb.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Every width (multiple of 8), height, refresh rate, scan type (progressive,
+ * interlace, doublescan) and depth in the configured ranges gets GTF timing.
+ * Unless a height range is given (-h), the heights are those that make the
+ * common aspect ratios with each width - a sweep over all heights produces
+ * millions of modes and a database of more than a gigabyte.
+ * A mode is kept if its pixel clock is within the PLL range, its VIDEL
+ * registers fit and its scanout leaves the CPU its share of the video RAM
+ * bandwidth (see modesel.c). The score is the bandwidth left for drawing.
+ *
+ * One task is one width. The tasks are dealt out round robin to per thread
+ * deques; a thread works from the bottom of its own deque and, once that is
+ * empty, steals from the top of the others'. Widths differ a lot in how many
+ * of their modes survive, so static partitioning would leave threads idle.
+ * Each thread collects into its own result list, the lists are merged and
+ * sorted by (width, height, bpp, refresh, scan) at the end.
+ *
+ * The result is printed as text, or with -b <file> written as the binary
+ * database the driver loads (see modedb.h).
+ */
+#define MAX_THREADS     64
+
+struct sweep
+{
+    short min, max, step;
+};
+
+static struct sweep widths = { 320, 1920, 8 };
+static struct sweep heights = { 200, 1200, 8 };
+static int all_heights;
+
+/* width : height */
+static const short aspects[][2] = { { 4, 3 }, { 5, 4 }, { 16, 10 }, { 16, 9 } };
+static struct sweep refreshes = { 50, 85, 1 };
+
+static const short depths[] = { 1, 8, 16, 24 };
+static const short scans[] = { 0, 1, -1 };      /* GTF flags: progressive, interlace, doublescan */
+
+struct mode_record
+{
+    short width;
+    short height;
+    short bpp;
+    short refresh;
+    short scan;
+    unsigned long actual_refresh;       /* mHz */
+    unsigned long free_bandwidth;       /* bytes/s, the score */
+    struct modeline modeline;
+    struct videl_timing videl;
+};
+
+struct result_list
+{
+    struct mode_record *records;
+    size_t count;
+    size_t size;
+};
+
+struct deque
+{
+    pthread_mutex_t lock;
+    short *tasks;                       /* widths */
+    int top;                            /* thieves take from here */
+    int bottom;                         /* the owner takes from here */
+};
+
+struct worker
+{
+    pthread_t thread;
+    int id;
+    struct result_list results;
+    long steals;
+};
+
+static struct deque deques[MAX_THREADS];
+static struct worker workers[MAX_THREADS];
+static int num_threads;
+static unsigned long budget;
+
+static void add_result(struct result_list *l, const struct mode_record *r)
+{
+    if (l->count == l->size)
+    {
+        l->size = l->size ? 2 * l->size : 1024;
+        l->records = realloc(l->records, l->size * sizeof(*l->records));
+        if (l->records == NULL)
+        {
+            fprintf(stderr, "mkmodedb: out of memory\n");
+            exit(1);
+        }
+    }
+    l->records[l->count++] = *r;
+}
+
+static int pop_bottom(struct deque *d, short *task)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        *task = d->tasks[--d->bottom];
+        ret = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return ret;
+}
+
+static int steal_top(struct deque *d, short *task)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        *task = d->tasks[d->top++];
+        ret = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return ret;
+}
+
+/* all refresh rates, scan types and depths of one size */
+static void sweep_size(short width, short height, struct result_list *results)
+{
+    for (short refresh = refreshes.min; refresh <= refreshes.max; refresh += refreshes.step)
+    {
+        for (unsigned s = 0; s < sizeof(scans) / sizeof(scans[0]); s++)
+        {
+            struct mode_record r;
+
+            general_timing_formula(width, height, refresh, scans[s], &r.modeline);
+
+            if (r.modeline.pixel_clock < modesel_config.min_pixel_clock ||
+                r.modeline.pixel_clock > modesel_config.max_pixel_clock)
+                continue;
+
+            videl_timing_from_modeline(&r.modeline, &r.videl);
+            if (!videl_timing_valid(&r.videl))
+                continue;
+
+            r.width = width;
+            r.height = height;
+            r.refresh = refresh;
+            r.scan = scans[s];
+            r.actual_refresh = modesel_actual_refresh(&r.modeline);
+
+            for (unsigned d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+            {
+                unsigned long bandwidth = modesel_scanout_bandwidth(&r.modeline, depths[d]);
+
+                /* deeper won't fit either */
+                if (bandwidth > budget)
+                    break;
+
+                r.bpp = depths[d];
+                r.free_bandwidth = budget - bandwidth;
+                add_result(results, &r);
+            }
+        }
+    }
+}
+
+/* all modes of one width */
+static void sweep_width(short width, struct result_list *results)
+{
+    if (all_heights)
+    {
+        for (short height = heights.min; height <= heights.max; height += heights.step)
+            sweep_size(width, height, results);
+        return;
+    }
+
+    for (unsigned a = 0; a < sizeof(aspects) / sizeof(aspects[0]); a++)
+    {
+        short height = width * aspects[a][1] / aspects[a][0];
+
+        if (height >= heights.min && height <= heights.max)
+            sweep_size(width, height, results);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = arg;
+    short task;
+
+    for (;;)
+    {
+        if (pop_bottom(&deques[w->id], &task))
+        {
+            sweep_width(task, &w->results);
+            continue;
+        }
+
+        /* own deque is empty - go stealing, starting with the next thread */
+        int found = 0;
+
+        for (int i = 1; i < num_threads && !found; i++)
+            found = steal_top(&deques[(w->id + i) % num_threads], &task);
+
+        if (!found)
+            break;      /* tasks are never added later, so everything is taken */
+
+        w->steals++;
+        sweep_width(task, &w->results);
+    }
+    return NULL;
+}
+
+static int compare_records(const void *a, const void *b)
+{
+    const struct mode_record *ra = a;
+    const struct mode_record *rb = b;
+
+    if (ra->width != rb->width)
+        return ra->width - rb->width;
+    if (ra->height != rb->height)
+        return ra->height - rb->height;
+    if (ra->bpp != rb->bpp)
+        return ra->bpp - rb->bpp;
+    if (ra->refresh != rb->refresh)
+        return ra->refresh - rb->refresh;
+    return ra->scan - rb->scan;
+}
+
+static void print_record(const struct mode_record *r)
+{
+    const struct modeline *ml = &r->modeline;
+    const struct videl_timing *vt = &r->videl;
+
+    printf("%4d %4d %2d %3d %2d %3lu.%03lu %3d %4d %4d %4d %4d %4d %4d %4d %4d "
+           "%4u %4u %4u %4u %4u %4u %4u %4u %4u %4u %4u %4u %10lu\n",
+           r->width, r->height, r->bpp, r->refresh, r->scan,
+           r->actual_refresh / 1000, r->actual_refresh % 1000,
+           ml->pixel_clock,
+           ml->h_display, ml->h_sync_start, ml->h_sync_end, ml->h_total,
+           ml->v_display, ml->v_sync_start, ml->v_sync_end, ml->v_total,
+           vt->hht, vt->hbb, vt->hbe, vt->hdb, vt->hde, vt->hss,
+           vt->vft, vt->vbb, vt->vbe, vt->vdb, vt->vde, vt->vss,
+           r->free_bandwidth);
+}
+
+static void put16(FILE *f, uint16_t v)
+{
+    fputc(v >> 8, f);
+    fputc(v & 0xff, f);
+}
+
+static void put32(FILE *f, uint32_t v)
+{
+    put16(f, v >> 16);
+    put16(f, v & 0xffff);
+}
+
+/* big endian, field by field, whatever the host's byte order and struct layout */
+static int write_database(const char *path, const struct result_list *l)
+{
+    FILE *f = fopen(path, "wb");
+
+    if (f == NULL)
+        return -1;
+
+    put32(f, MODEDB_MAGIC);
+    put16(f, MODEDB_VERSION);
+    put16(f, sizeof(struct modedb_record));
+    put32(f, l->count);
+    put32(f, 0);
+
+    for (size_t i = 0; i < l->count; i++)
+    {
+        const struct mode_record *r = &l->records[i];
+
+        put16(f, r->width);
+        put16(f, r->height);
+        put16(f, r->bpp);
+        put16(f, r->refresh);
+    }
+
+    for (size_t i = 0; i < l->count; i++)
+    {
+        const struct mode_record *r = &l->records[i];
+        const struct modeline *ml = &r->modeline;
+        const struct videl_timing *vt = &r->videl;
+
+        put16(f, ml->pixel_clock);
+        put16(f, (ml->flags.interlace ? MODEDB_INTERLACE : 0) |
+                 (ml->flags.double_scan ? MODEDB_DOUBLE_SCAN : 0) |
+                 (ml->flags.hsync_polarity ? MODEDB_HSYNC_POLARITY : 0) |
+                 (ml->flags.vsync_polarity ? MODEDB_VSYNC_POLARITY : 0));
+        put16(f, ml->h_display);
+        put16(f, ml->h_sync_start);
+        put16(f, ml->h_sync_end);
+        put16(f, ml->h_total);
+        put16(f, ml->v_display);
+        put16(f, ml->v_sync_start);
+        put16(f, ml->v_sync_end);
+        put16(f, ml->v_total);
+
+        put16(f, vt->hht);
+        put16(f, vt->hbb);
+        put16(f, vt->hbe);
+        put16(f, vt->hdb);
+        put16(f, vt->hde);
+        put16(f, vt->hss);
+        put16(f, vt->vft);
+        put16(f, vt->vbb);
+        put16(f, vt->vbe);
+        put16(f, vt->vdb);
+        put16(f, vt->vde);
+        put16(f, vt->vss);
+
+        put32(f, r->actual_refresh);
+        put32(f, r->free_bandwidth);
+    }
+
+    if (ferror(f))
+    {
+        fclose(f);
+        return -1;
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int parse_sweep(const char *arg, struct sweep *s)
+{
+    short step = s->step;
+
+    if (sscanf(arg, "%hd:%hd:%hd", &s->min, &s->max, &step) < 2 || step <= 0 || s->min > s->max)
+        return -1;
+    s->step = step;
+
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-w min:max[:step]] [-h min:max[:step]] [-r min:max[:step]] [-b database]\n",
+            name);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct result_list all = { NULL, 0, 0 };
+    int num_tasks;
+    int opt;
+    long steals = 0;
+    const char *database = NULL;
+
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "j:w:h:r:b:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j':
+                num_threads = atoi(optarg);
+                break;
+            case 'w':
+                if (parse_sweep(optarg, &widths) != 0)
+                    usage(argv[0]);
+                break;
+            case 'h':
+                if (parse_sweep(optarg, &heights) != 0)
+                    usage(argv[0]);
+                all_heights = 1;
+                break;
+            case 'r':
+                if (parse_sweep(optarg, &refreshes) != 0)
+                    usage(argv[0]);
+                break;
+            case 'b':
+                database = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (num_threads < 1)
+        num_threads = 1;
+    if (num_threads > MAX_THREADS)
+        num_threads = MAX_THREADS;
+
+    widths.min = (widths.min + 7) & ~7;
+    widths.step = (widths.step + 7) & ~7;
+    budget = modesel_config.vram_bandwidth / 100 * (100 - modesel_config.cpu_headroom);
+
+    /* deal the widths out round robin */
+    num_tasks = (widths.max - widths.min) / widths.step + 1;
+    for (int t = 0; t < num_threads; t++)
+    {
+        pthread_mutex_init(&deques[t].lock, NULL);
+        deques[t].tasks = malloc(num_tasks * sizeof(short));
+        deques[t].top = deques[t].bottom = 0;
+    }
+    for (int i = 0; i < num_tasks; i++)
+    {
+        struct deque *d = &deques[i % num_threads];
+
+        d->tasks[d->bottom++] = widths.min + i * widths.step;
+    }
+
+    for (int t = 0; t < num_threads; t++)
+    {
+        workers[t].id = t;
+        if (pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]) != 0)
+        {
+            fprintf(stderr, "%s: could not start worker thread\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    for (int t = 0; t < num_threads; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        for (size_t i = 0; i < workers[t].results.count; i++)
+            add_result(&all, &workers[t].results.records[i]);
+        free(workers[t].results.records);
+        free(deques[t].tasks);
+        steals += workers[t].steals;
+    }
+
+    qsort(all.records, all.count, sizeof(*all.records), compare_records);
+
+    if (database != NULL)
+    {
+        if (write_database(database, &all) != 0)
+        {
+            fprintf(stderr, "%s: could not write %s\n", argv[0], database);
+            remove(database);
+            exit(1);
+        }
+        fprintf(stderr, "mkmodedb: %zu modes, %d threads, %ld tasks stolen\n", all.count, num_threads, steals);
+        free(all.records);
+        return 0;
+    }
+
+    printf("# generated by mkmodedb - do not edit\n");
+    printf("# width height bpp refresh scan(1 interlace, -1 doublescan) actual_refresh pixel_clock\n");
+    printf("# h_display h_sync_start h_sync_end h_total v_display v_sync_start v_sync_end v_total\n");
+    printf("# hht hbb hbe hdb hde hss vft vbb vbe vdb vde vss free_bandwidth\n");
+    for (size_t i = 0; i < all.count; i++)
+        print_record(&all.records[i]);
+
+    fprintf(stderr, "mkmodedb: %zu modes, %d threads, %ld tasks stolen\n", all.count, num_threads, steals);
+    free(all.records);
+
+    return 0;
+}
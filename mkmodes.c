@@ -0,0 +1,182 @@
+/*
+ * mkmodes.c - generate the precalculated video mode table (host tool)
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modeline.h"
+#include "videl.h"
+#include "modesel.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * built in resolutions. Additional ones can be given on the command
+ * line (EXTRA_MODES in the Makefile) as <width>x<height>x<bpp>@<freq>[c|r|p][i|d].
+ * A 'c' suffix uses CVT instead of GTF timing, 'r' CVT with reduced blanking,
+ * 'p' GTF timing adjusted to hit the refresh rate with a whole MHz pixel clock.
+ * 'i' makes the mode interlaced, 'd' doublescanned.
+ * A frequency of 0 lets modesel_select() pick the highest refresh rate that
+ * fits into the video RAM bandwidth budget
+ */
+static struct res
+{
+    short width;
+    short height;
+    short bpp;
+    short freq;
+    short scan;         /* GTF/CVT flags: 0 progressive, 1 interlace, -1 doublescan */
+} rs[] = {
+    /* doublescanned, so the monitor sees 480 lines without a 130 Hz refresh */
+    { 320, 240, 8, 60, -1 },
+    { 640, 480, 1, 70 },
+    { 640, 480, 8, 60 },
+    { 640, 480, 16, 70 },
+    { 640, 480, 24, 50 },
+};
+
+enum timing
+{
+    TIMING_GTF,
+    TIMING_CVT,
+    TIMING_CVT_RB,
+    TIMING_GTF_PLL
+};
+
+static void emit_mode(struct res *res, enum timing timing)
+{
+    struct modeline ml;
+    struct videl_timing vt;
+
+    /*
+     * round down horizontal resolution to closest multiple of 8. Otherwise we get staircases
+     */
+    res->width &= ~7;
+
+    if (res->scan != 0 && (res->freq == 0 || timing == TIMING_GTF_PLL))
+    {
+        fprintf(stderr, "mkmodes: %dx%dx%d: interlace and doublescan need a given refresh rate and GTF or CVT timing\n",
+                res->width, res->height, res->bpp);
+        exit(1);
+    }
+
+    if (res->freq == 0)
+    {
+        struct modesel_result sel;
+
+        if (modesel_select(res->width, res->height, res->bpp, &sel) != 0)
+        {
+            fprintf(stderr, "mkmodes: no refresh rate for %dx%dx%d fits the video RAM bandwidth\n",
+                    res->width, res->height, res->bpp);
+            exit(1);
+        }
+        ml = sel.modeline;
+        res->freq = sel.refresh;
+    }
+    else if (timing == TIMING_GTF_PLL)
+    {
+        struct modesel_result sel;
+
+        if (modesel_optimize_clock(res->width, res->height, res->bpp, res->freq, &sel) != 0)
+        {
+            fprintf(stderr, "mkmodes: no whole MHz pixel clock timing for %dx%dx%d@%d\n",
+                    res->width, res->height, res->bpp, res->freq);
+            exit(1);
+        }
+        ml = sel.modeline;
+    }
+    else if (timing == TIMING_GTF)
+        general_timing_formula_fixed(&gtf_default_display, res->width, res->height, res->freq, res->scan, &ml);
+    else
+        coordinated_video_timing(res->width, res->height, res->freq, res->scan, timing == TIMING_CVT_RB, &ml);
+    videl_timing_from_modeline(&ml, &vt);
+
+    printf("    {\n");
+    printf("        /* %lu.%03lu Hz, scanout %lu kB/s, %lu kB/s left for drawing */\n",
+           modesel_actual_refresh(&ml) / 1000, modesel_actual_refresh(&ml) % 1000,
+           modesel_scanout_bandwidth(&ml, res->bpp) / 1000,
+           (modesel_config.vram_bandwidth - modesel_scanout_bandwidth(&ml, res->bpp)) / 1000);
+    printf("        .width = %d, .height = %d, .bpp = %d, .freq = %d,\n",
+           res->width, res->height, res->bpp, res->freq);
+    printf("        .modeline = {\n");
+    printf("            .pixel_clock = %d,\n", ml.pixel_clock);
+    printf("            .h_display = %d, .h_sync_start = %d, .h_sync_end = %d, .h_total = %d,\n",
+           ml.h_display, ml.h_sync_start, ml.h_sync_end, ml.h_total);
+    printf("            .v_display = %d, .v_sync_start = %d, .v_sync_end = %d, .v_total = %d,\n",
+           ml.v_display, ml.v_sync_start, ml.v_sync_end, ml.v_total);
+    printf("            .flags = { .interlace = %d, .double_scan = %d, .hsync_polarity = %d, .vsync_polarity = %d }\n",
+           ml.flags.interlace ? -1 : 0, ml.flags.double_scan ? -1 : 0,
+           ml.flags.hsync_polarity ? -1 : 0, ml.flags.vsync_polarity ? -1 : 0);
+    printf("        },\n");
+    printf("        .videl = {\n");
+    printf("            .hht = %u, .hbb = %u, .hbe = %u, .hdb = %u, .hde = %u, .hss = %u,\n",
+           vt.hht, vt.hbb, vt.hbe, vt.hdb, vt.hde, vt.hss);
+    printf("            .vft = %u, .vbb = %u, .vbe = %u, .vdb = %u, .vde = %u, .vss = %u\n",
+           vt.vft, vt.vbb, vt.vbe, vt.vdb, vt.vde, vt.vss);
+    printf("        }\n");
+    printf("    },\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int count = 0;
+
+    printf("/* generated by mkmodes - do not edit */\n\n");
+    printf("#include \"modetab.h\"\n\n");
+    printf("const struct modetab_entry modetab[] =\n{\n");
+
+    for (int i = 0; i < sizeof(rs) / sizeof(rs[0]); i++)
+    {
+        emit_mode(&rs[i], TIMING_GTF);
+        count++;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        struct res res;
+        int end = 0;
+        enum timing timing = TIMING_GTF;
+        int valid;
+
+        res.scan = 0;
+        valid = sscanf(argv[i], "%hdx%hdx%hd@%hd%n", &res.width, &res.height, &res.bpp, &res.freq, &end) >= 4;
+
+        /* at most one timing and one scan type suffix */
+        for (const char *p = argv[i] + end; valid && *p != '\0'; p++)
+        {
+            if ((*p == 'c' || *p == 'r' || *p == 'p') && timing == TIMING_GTF)
+                timing = *p == 'c' ? TIMING_CVT : *p == 'r' ? TIMING_CVT_RB : TIMING_GTF_PLL;
+            else if ((*p == 'i' || *p == 'd') && res.scan == 0)
+                res.scan = *p == 'i' ? 1 : -1;
+            else
+                valid = 0;
+        }
+
+        if (!valid)
+        {
+            fprintf(stderr, "%s: illegal mode specification \"%s\" (expected <width>x<height>x<bpp>@<freq>[c|r|p][i|d])\n",
+                    argv[0], argv[i]);
+            exit(1);
+        }
+        emit_mode(&res, timing);
+        count++;
+    }
+
+    printf("};\n\n");
+    printf("const short modetab_size = %d;\n", count);
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * modecache.c - memoize modeline calculations
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modeline.h"
+
+/*
+ * a resident driver gets asked for the same few modes over and over again.
+ * Keep the last MODECACHE_SIZE results around, replacing round robin
+ */
+#define MODECACHE_SIZE  16
+
+static struct modecache_entry
+{
+    short valid;
+    int width;
+    int height;
+    int refresh;
+    int flags;
+    struct modeline modeline;
+} modecache[MODECACHE_SIZE];
+
+static short modecache_next;
+
+void modeline_lookup(int width, int height, int refresh, int flags, struct modeline *modeline)
+{
+    struct modecache_entry *ce;
+
+    for (ce = &modecache[0]; ce < &modecache[MODECACHE_SIZE]; ce++)
+    {
+        if (ce->valid && ce->width == width && ce->height == height &&
+            ce->refresh == refresh && ce->flags == flags)
+        {
+            *modeline = ce->modeline;
+            return;
+        }
+    }
+
+    ce = &modecache[modecache_next];
+    modecache_next = (modecache_next + 1) % MODECACHE_SIZE;
+
+    general_timing_formula_fixed(&gtf_default_display, width, height, refresh, flags, &ce->modeline);
+    ce->width = width;
+    ce->height = height;
+    ce->refresh = refresh;
+    ce->flags = flags;
+    ce->valid = 1;
+
+    *modeline = ce->modeline;
+}
+
+void modeline_cache_flush(void)
+{
+    for (int i = 0; i < MODECACHE_SIZE; i++)
+        modecache[i].valid = 0;
+    modecache_next = 0;
+}
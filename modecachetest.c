@@ -0,0 +1,106 @@
+/*
+ * modecachetest.c - check the modeline cache
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modeline.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Linked with --wrap=general_timing_formula_fixed, so every calculation the
+ * cache (modecache.c) does is counted: a lookup that adds to the count was a
+ * miss. Checks that hits give the same modeline as an uncached calculation,
+ * that the 17th distinct mode replaces the oldest entry (round robin) and that
+ * modeline_cache_flush() forgets everything.
+ */
+#define CACHE_SIZE  16      /* MODECACHE_SIZE in modecache.c */
+
+void __real_general_timing_formula_fixed(const struct display_fixed *Display, int HRes, int VRes, long Clock,
+                                         int Flags, struct modeline *modeline);
+
+static int calculations;
+static int failed;
+
+void __wrap_general_timing_formula_fixed(const struct display_fixed *Display, int HRes, int VRes, long Clock,
+                                         int Flags, struct modeline *modeline)
+{
+    calculations++;
+    __real_general_timing_formula_fixed(Display, HRes, VRes, Clock, Flags, modeline);
+}
+
+/* the distinct mode number <i> */
+static int width(int i)
+{
+    return 640 + 16 * i;
+}
+
+/*
+ * look up mode <i> and check that it is a hit or a miss as <expect_hit> says and
+ * that it gives the uncached result
+ */
+static void check(int i, int expect_hit, const char *what)
+{
+    struct modeline cached;
+    struct modeline direct;
+    int before = calculations;
+    int hit;
+
+    memset(&cached, 0, sizeof(cached));
+    memset(&direct, 0, sizeof(direct));
+    modeline_lookup(width(i), 480, 60, 0, &cached);
+    hit = calculations == before;
+
+    __real_general_timing_formula_fixed(&gtf_default_display, width(i), 480, 60, 0, &direct);
+
+    if (hit != expect_hit)
+    {
+        printf("FAILED: %s: %dx480@60 was a %s\n", what, width(i), hit ? "hit" : "miss");
+        failed++;
+    }
+    if (memcmp(&cached, &direct, sizeof(cached)) != 0)
+    {
+        printf("FAILED: %s: %dx480@60 differs from the uncached modeline\n", what, width(i));
+        failed++;
+    }
+}
+
+int main(void)
+{
+    modeline_cache_flush();
+
+    for (int i = 0; i < CACHE_SIZE; i++)
+        check(i, 0, "first lookup");
+    for (int i = 0; i < CACHE_SIZE; i++)
+        check(i, 1, "second lookup");
+
+    /* the 17th mode takes the slot of the 1st, which then takes the 2nd's */
+    check(CACHE_SIZE, 0, "17th mode");
+    check(CACHE_SIZE, 1, "17th mode again");
+    check(2, 1, "3rd mode after the 17th");
+    check(0, 0, "1st mode after the 17th");
+    check(1, 0, "2nd mode after the 1st came back");
+
+    check(1, 1, "2nd mode, cached");
+    modeline_cache_flush();
+    check(1, 0, "after flush");
+    check(1, 1, "after flush, again");
+
+    printf("modeline cache: %d calculations, %s\n", calculations, failed ? "FAILED" : "ok");
+
+    return failed != 0;
+}
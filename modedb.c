@@ -0,0 +1,153 @@
+/*
+ * modedb.c - binary video mode database
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modedb.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <osbind.h>
+
+/*
+ * The whole file is read with one Fread() and used in place: the header is
+ * checked, the index and record arrays are pointed into the buffer and
+ * lookups are a binary search over the index. Nothing is parsed or copied.
+ */
+
+static int key_compare(const struct modedb_key *k, short width, short height, short bpp, short refresh)
+{
+    if (k->width != width)
+        return k->width < width ? -1 : 1;
+    if (k->height != height)
+        return k->height < height ? -1 : 1;
+    if (k->bpp != bpp)
+        return k->bpp < bpp ? -1 : 1;
+    if (k->refresh != refresh)
+        return k->refresh < refresh ? -1 : 1;
+    return 0;
+}
+
+/*
+ * load the database at <path>. Returns 0 on success, -1 if the file can't be
+ * read or is not a mode database of this version
+ */
+int modedb_load(struct modedb *db, const char *path)
+{
+    const struct modedb_header *h;
+    long fd;
+    long size;
+
+    db->block = NULL;
+
+    fd = Fopen(path, 0);
+    if (fd < 0)
+        return -1;
+
+    size = Fseek(0, fd, 2);
+    Fseek(0, fd, 0);
+
+    if (size >= (long) sizeof(struct modedb_header))
+        db->block = malloc(size);
+
+    if (db->block == NULL || Fread(fd, size, db->block) != size)
+    {
+        Fclose(fd);
+        modedb_free(db);
+        return -1;
+    }
+    Fclose(fd);
+
+    h = db->block;
+    if (h->magic != MODEDB_MAGIC || h->version != MODEDB_VERSION ||
+        h->record_size != sizeof(struct modedb_record) ||
+        size != (long) (sizeof(*h) + h->count * (sizeof(struct modedb_key) + sizeof(struct modedb_record))))
+    {
+        modedb_free(db);
+        return -1;
+    }
+
+    db->count = h->count;
+    db->index = (const struct modedb_key *) (h + 1);
+    db->records = (const struct modedb_record *) (db->index + db->count);
+
+    return 0;
+}
+
+void modedb_free(struct modedb *db)
+{
+    free(db->block);
+    db->block = NULL;
+    db->count = 0;
+}
+
+/*
+ * the record for <width> x <height> x <bpp> @ <refresh> with scan type <scan>
+ * (0 progressive, > 0 interlace, < 0 doublescan), NULL if there is none
+ */
+const struct modedb_record *modedb_find(const struct modedb *db, short width, short height, short bpp,
+                                        short refresh, short scan)
+{
+    uint16_t want = scan > 0 ? MODEDB_INTERLACE : scan < 0 ? MODEDB_DOUBLE_SCAN : 0;
+    long lo = 0;
+    long hi = db->count;
+
+    /* first key that is not less than what we look for */
+    while (lo < hi)
+    {
+        long mid = (lo + hi) / 2;
+
+        if (key_compare(&db->index[mid], width, height, bpp, refresh) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < (long) db->count && key_compare(&db->index[lo], width, height, bpp, refresh) == 0; lo++)
+        if ((db->records[lo].flags & (MODEDB_INTERLACE | MODEDB_DOUBLE_SCAN)) == want)
+            return &db->records[lo];
+
+    return NULL;
+}
+
+/*
+ * fill a mode table entry from <rec>, so it can be used like one of the built in modes
+ */
+void modedb_entry(const struct modedb *db, const struct modedb_record *rec, struct modetab_entry *entry)
+{
+    const struct modedb_key *key = &db->index[rec - db->records];
+
+    entry->width = key->width;
+    entry->height = key->height;
+    entry->bpp = key->bpp;
+    entry->freq = key->refresh;
+
+    entry->modeline.pixel_clock = rec->pixel_clock;
+    entry->modeline.h_display = rec->h_display;
+    entry->modeline.h_sync_start = rec->h_sync_start;
+    entry->modeline.h_sync_end = rec->h_sync_end;
+    entry->modeline.h_total = rec->h_total;
+    entry->modeline.v_display = rec->v_display;
+    entry->modeline.v_sync_start = rec->v_sync_start;
+    entry->modeline.v_sync_end = rec->v_sync_end;
+    entry->modeline.v_total = rec->v_total;
+    entry->modeline.flags.interlace = (rec->flags & MODEDB_INTERLACE) != 0;
+    entry->modeline.flags.double_scan = (rec->flags & MODEDB_DOUBLE_SCAN) != 0;
+    entry->modeline.flags.hsync_polarity = (rec->flags & MODEDB_HSYNC_POLARITY) != 0;
+    entry->modeline.flags.vsync_polarity = (rec->flags & MODEDB_VSYNC_POLARITY) != 0;
+
+    entry->videl = rec->videl;
+}
@@ -0,0 +1,84 @@
+/*
+ * modedb.h - binary video mode database
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef MODEDB_H
+#define MODEDB_H
+
+#include <stdint.h>
+#include "modetab.h"
+
+/*
+ * File layout, all numbers big endian (the FireBee's byte order, so the
+ * driver uses the file as it comes from disk):
+ *
+ *  struct modedb_header
+ *  struct modedb_key       index[count], sorted by width, height, bpp, refresh
+ *  struct modedb_record    records[count], in index order
+ *
+ * A key may appear more than once, for different scan types. The file is
+ * written by mkmodedb -b
+ */
+#define MODEDB_MAGIC    0x46424d44UL        /* "FBMD" */
+#define MODEDB_VERSION  1
+
+struct modedb_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;                   /* sizeof(struct modedb_record) */
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct modedb_key
+{
+    uint16_t width;
+    uint16_t height;
+    uint16_t bpp;
+    uint16_t refresh;
+};
+
+enum modedb_flags
+{
+    MODEDB_INTERLACE = (1 << 0),
+    MODEDB_DOUBLE_SCAN = (1 << 1),
+    MODEDB_HSYNC_POLARITY = (1 << 2),
+    MODEDB_VSYNC_POLARITY = (1 << 3),
+};
+
+struct modedb_record
+{
+    uint16_t pixel_clock;                   /* MHz */
+    uint16_t flags;                         /* enum modedb_flags */
+    uint16_t h_display;
+    uint16_t h_sync_start;
+    uint16_t h_sync_end;
+    uint16_t h_total;
+    uint16_t v_display;
+    uint16_t v_sync_start;
+    uint16_t v_sync_end;
+    uint16_t v_total;
+    struct videl_timing videl;              /* register image */
+    uint32_t actual_refresh;                /* mHz */
+    uint32_t free_bandwidth;                /* bytes/s left for drawing */
+};
+
+struct modedb
+{
+    void *block;                            /* the file as loaded */
+    uint32_t count;
+    const struct modedb_key *index;
+    const struct modedb_record *records;
+};
+
+int modedb_load(struct modedb *db, const char *path);
+void modedb_free(struct modedb *db);
+const struct modedb_record *modedb_find(const struct modedb *db, short width, short height, short bpp,
+                                        short refresh, short scan);
+void modedb_entry(const struct modedb *db, const struct modedb_record *rec, struct modetab_entry *entry);
+
+#endif /* MODEDB_H */
@@ -36,7 +36,9 @@ static inline double floor(double input)
 
 static inline double ceil(double input)
 {
-    return ((double) ((int) (input + 1.0)));
+    int i = (int) input;
+
+    return ((double) (input > i ? i + 1 : i));
 }
 
 static inline double sqrt(const double fg)
@@ -57,7 +59,7 @@ static inline double sqrt(const double fg)
     return n;
 }
 
-static struct display dsp =
+static const struct display dsp =
 {
     .CharacterCell = 8.0,
     .PClockStep = 0.0,
@@ -78,7 +80,19 @@ static struct display dsp =
 
 void general_timing_formula(double HRes, double VRes, double Clock, double Flags, struct modeline *modeline)
 {
-    struct display *Display = &dsp;
+    general_timing_formula_r(&dsp, HRes, VRes, Clock, Flags, modeline);
+}
+
+/*
+ * reentrant version of the above. The worksheet below rounds and rescales the
+ * display parameters in place, so it works on a private copy of <Params> and
+ * repeated calls with the same arguments give the same result
+ */
+void general_timing_formula_r(const struct display *Params, double HRes, double VRes, double Clock, double Flags,
+                              struct modeline *modeline)
+{
+    struct display Work = *Params;
+    struct display *Display = &Work;
 
     /* define Clock variables */
     double RefreshRate = 0;
@@ -547,4 +561,187 @@ void general_timing_formula(double HRes, double VRes, double Clock, double Flags
 
     modeline->flags.hsync_polarity = 0;
     modeline->flags.vsync_polarity = 1;
-} //general_timing_formula()
+} //general_timing_formula_r()
+
+
+/***************************************************************************
+ *                                                                         *
+ *   VESA Coordinated Video Timing (CVT 1.1), CRT and reduced blanking.    *
+ *                                                                         *
+ ***************************************************************************/
+
+/* CVT constants that are not part of struct display */
+#define CVT_MIN_V_PORCH     3.0         // minimum front porch lines
+#define CVT_CLOCK_STEP      0.25        // pixel clock stepping if Display->PClockStep isn't set
+#define CVT_RB_V_FPORCH     3.0         // reduced blanking vertical front porch
+
+/*
+ * CVT encodes the aspect ratio in the vertical sync width
+ */
+static double cvt_vsync_width(int HRes, int VRes)
+{
+    if (!(VRes % 3) && (VRes * 4 / 3) == HRes)
+        return 4.0;
+    else if (!(VRes % 9) && (VRes * 16 / 9) == HRes)
+        return 5.0;
+    else if (!(VRes % 10) && (VRes * 16 / 10) == HRes)
+        return 6.0;
+    else if (!(VRes % 4) && (VRes * 5 / 4) == HRes)
+        return 7.0;
+    else if (!(VRes % 9) && (VRes * 15 / 9) == HRes)
+        return 7.0;
+
+    return 10.0;
+}
+
+void coordinated_video_timing(double HRes, double VRes, double Refresh, double Flags, int ReducedBlanking,
+                              struct modeline *modeline)
+{
+    coordinated_video_timing_r(&dsp, HRes, VRes, Refresh, Flags, ReducedBlanking, modeline);
+}
+
+/*
+ * CVT modeline for the refresh rate <Refresh>. Flags has the same meaning as for the GTF
+ * (> 0 interlace, < 0 doublescan). With <ReducedBlanking> set, the horizontal blanking is
+ * fixed to Params->HBlankingTicks pixels and the vertical blanking to the minimum of
+ * Params->VBlankingTime us, which considerably lowers the pixel clock (and thus the
+ * video memory fetch rate) for high resolutions
+ */
+void coordinated_video_timing_r(const struct display *Params, double HRes, double VRes, double Refresh, double Flags,
+                                int ReducedBlanking, struct modeline *modeline)
+{
+    double CharacterCell = round(Params->CharacterCell);
+    double ClockStep = Params->PClockStep > 0 ? Params->PClockStep : CVT_CLOCK_STEP;
+    double M = (Params->K / 256.0) * Params->M;
+    double C = ((Params->C - Params->J) * Params->K / 256.0) + Params->J;
+
+    double FieldRate;
+    double HPixels;
+    double LeftMargin = 0;
+    double TopMargin = 0;
+    double HActive;
+    double VLines;
+    double Interlace;
+    double VSyncWidth;
+    double HPeriodEstimate;
+    double HBlank;
+    double HSyncWidth;
+    double HTotal;
+    double VFrontPorch;
+    double VBlank;
+    double VTotal;
+    double PClock;
+
+    modeline->flags.double_scan = 0;
+    modeline->flags.interlace = 0;
+
+    if (CharacterCell < 1)
+    {
+        printf("Error:  character cell less than 1 pixel.\n");
+        CharacterCell = 1;
+    }
+
+    FieldRate = Flags > 0 ? Refresh * 2.0 : Refresh;
+
+    HPixels = floor(HRes / CharacterCell) * CharacterCell;
+    if (Params->Margin > 0)
+        LeftMargin = floor(HPixels * Params->Margin / 100.0 / CharacterCell) * CharacterCell;
+    HActive = HPixels + 2.0 * LeftMargin;
+
+    if (Flags > 0)  // if interlace mode
+        VLines = floor(VRes / 2.0);
+    else if (Flags < 0)  // if doublescan mode
+        VLines = floor(VRes) * 2.0;
+    else
+        VLines = floor(VRes);
+    if (Params->Margin > 0)
+        TopMargin = floor(Params->Margin / 100.0 * VLines);
+
+    Interlace = Flags > 0 ? 0.5 : 0.0;
+    VSyncWidth = cvt_vsync_width((int) HPixels, (int) floor(VRes));
+
+    if (!ReducedBlanking)
+    {
+        double IdealDutyCycle;
+        double VSyncPlusBackPorch;
+
+        VFrontPorch = CVT_MIN_V_PORCH;
+
+        HPeriodEstimate = ((1.0 / FieldRate) - Params->VBackPorchPlusSync / 1000000.0) /
+                          (VLines + 2.0 * TopMargin + VFrontPorch + Interlace) * 1000000.0;
+
+        VSyncPlusBackPorch = floor(Params->VBackPorchPlusSync / HPeriodEstimate) + 1.0;
+        if (VSyncPlusBackPorch < VSyncWidth + Params->VBackPorch)
+            VSyncPlusBackPorch = VSyncWidth + Params->VBackPorch;
+
+        VBlank = VSyncPlusBackPorch + VFrontPorch;
+        VTotal = VLines + 2.0 * TopMargin + VBlank + Interlace;
+
+        IdealDutyCycle = C - (M * HPeriodEstimate / 1000.0);
+        if (IdealDutyCycle < 20.0)
+            IdealDutyCycle = 20.0;
+
+        HBlank = floor(HActive * IdealDutyCycle / (100.0 - IdealDutyCycle) / (2.0 * CharacterCell)) *
+                 2.0 * CharacterCell;
+        HTotal = HActive + HBlank;
+
+        PClock = ClockStep * floor((HTotal / HPeriodEstimate) / ClockStep);
+
+        HSyncWidth = floor(Params->HSyncPercent / 100.0 * HTotal / CharacterCell) * CharacterCell;
+    }
+    else
+    {
+        double VBlankLines;
+        double MinVBlankLines;
+
+        VFrontPorch = CVT_RB_V_FPORCH;
+
+        HPeriodEstimate = ((1000000.0 / FieldRate) - Params->VBlankingTime) / (VLines + 2.0 * TopMargin);
+
+        VBlankLines = floor(Params->VBlankingTime / HPeriodEstimate) + 1.0;
+        MinVBlankLines = VFrontPorch + VSyncWidth + Params->VBackPorch;
+        VBlank = VBlankLines < MinVBlankLines ? MinVBlankLines : VBlankLines;
+        VTotal = VLines + 2.0 * TopMargin + VBlank + Interlace;
+
+        HBlank = Params->HBlankingTicks;
+        HTotal = HActive + HBlank;
+
+        PClock = ClockStep * floor((FieldRate * VTotal * HTotal / 1000000.0) / ClockStep);
+
+        HSyncWidth = Params->HSyncTicks;
+    }
+
+    modeline->pixel_clock = (int) PClock;
+    modeline->h_display = (int) HPixels;
+    modeline->h_sync_end = (int) (HTotal - HBlank / 2.0);
+    modeline->h_sync_start = modeline->h_sync_end - (int) HSyncWidth;
+    modeline->h_total = (int) HTotal;
+
+    if (Flags > 0)  // if interlace mode
+    {
+        modeline->flags.interlace = 1;
+        modeline->v_display = (int) (VLines * 2.0);
+        modeline->v_sync_start = (int) ((VLines + 2.0 * TopMargin + VFrontPorch) * 2.0);
+        modeline->v_sync_end = modeline->v_sync_start + (int) (VSyncWidth * 2.0);
+        modeline->v_total = (int) (VTotal * 2.0);
+    }
+    else if (Flags < 0)  // if doublescan mode
+    {
+        modeline->flags.double_scan = 1;
+        modeline->v_display = (int) (VLines / 2.0);
+        modeline->v_sync_start = (int) ((VLines + 2.0 * TopMargin + VFrontPorch) / 2.0);
+        modeline->v_sync_end = modeline->v_sync_start + (int) (VSyncWidth / 2.0);
+        modeline->v_total = (int) (VTotal / 2.0);
+    }
+    else
+    {
+        modeline->v_display = (int) VLines;
+        modeline->v_sync_start = (int) (VLines + 2.0 * TopMargin + VFrontPorch);
+        modeline->v_sync_end = modeline->v_sync_start + (int) VSyncWidth;
+        modeline->v_total = (int) VTotal;
+    }
+
+    /* CVT: negative hsync, positive vsync. Reduced blanking: the other way round */
+    modeline->flags.hsync_polarity = ReducedBlanking ? 1 : 0;
+    modeline->flags.vsync_polarity = ReducedBlanking ? 0 : 1;
+} //coordinated_video_timing_r()
@@ -31,6 +31,36 @@ struct display
     double VBlankingTime;         //minimum vertical blanking time
 };
 
+/*
+ * integer version of the above for general_timing_formula_fixed(). Same units,
+ * except for PClockStep which is in kHz instead of MHz
+ */
+struct display_fixed
+{
+    int CharacterCell;
+    int PClockStep;
+
+    int HSyncPercent;
+
+    int M;
+    int C;
+    int K;
+    int J;
+
+    int VFrontPorch;
+    int VBackPorchPlusSync;
+    int VSyncWidth;
+    int VBackPorch;
+
+    int Margin;
+
+    int HBlankingTicks;
+    int HSyncTicks;
+    int VBlankingTime;
+};
+
+extern const struct display_fixed gtf_default_display;
+
 
 /*
  * this is the programmatic representation of a standard X-Windows modeline
@@ -60,5 +90,19 @@ struct modeline
 };
 
 void general_timing_formula(double HRes, double VRes, double Clock, double Flags, struct modeline *modeline);
+void general_timing_formula_r(const struct display *Params, double HRes, double VRes, double Clock, double Flags,
+                              struct modeline *modeline);
+void coordinated_video_timing(double HRes, double VRes, double Refresh, double Flags, int ReducedBlanking,
+                              struct modeline *modeline);
+void coordinated_video_timing_r(const struct display *Params, double HRes, double VRes, double Refresh, double Flags,
+                                int ReducedBlanking, struct modeline *modeline);
+void general_timing_formula_fixed(const struct display_fixed *Display, int HRes, int VRes, long Clock, int Flags,
+                                  struct modeline *modeline);
+
+/*
+ * modeline cache (modecache.c) for the integer GTF with default parameters
+ */
+void modeline_lookup(int width, int height, int refresh, int flags, struct modeline *modeline);
+void modeline_cache_flush(void);
 
 #endif // MODELINE_H
@@ -0,0 +1,70 @@
+/*
+ * modesel.c - memory bandwidth aware video mode selection
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modesel.h"
+#include "fb_video.h"
+
+/*
+ * the bandwidth figure is an estimate (half the peak rate of the FireBee's 32 bit
+ * DDR RAM at 133 MHz); replace it with a measured one if you have it
+ */
+struct modesel_config modesel_config =
+{
+    .vram_bandwidth = 532000000UL,
+    .cpu_headroom = 25,
+    .min_refresh = 50,
+    .max_refresh = 85,
+    .min_pixel_clock = 10,
+    .max_pixel_clock = 200
+};
+
+/*
+ * bytes per second the video scanout fetches for <ml> at <bpp> bits per pixel. Only
+ * the active part of the frame is fetched, so this is the pixel clock times the
+ * bytes per pixel (as stored in video RAM) times the active to total ratio
+ */
+unsigned long modesel_scanout_bandwidth(const struct modeline *ml, short bpp)
+{
+    unsigned long long active = (unsigned long long) ml->h_display * ml->v_display;
+    unsigned long long total = (unsigned long long) ml->h_total * ml->v_total;
+
+    if (total == 0)
+        return 0;
+
+    return (unsigned long) ((unsigned long long) ml->pixel_clock * 1000000ULL * fb_pixel_bits(bpp) / 8 *
+                            active / total);
+}
+
+/*
+ * refresh (frame) rate in mHz the hardware produces for <ml>. The PLL only does
+ * whole MHz, which is exactly what the modeline pixel clock holds. An interlaced
+ * v_total already counts both fields, a doublescanned line is fetched twice
+ */
+unsigned long modesel_actual_refresh(const struct modeline *ml)
+{
+    unsigned long long total = (unsigned long long) ml->h_total * ml->v_total;
+
+    if (total == 0)
+        return 0;
+
+    if (ml->flags.double_scan)
+        total *= 2;
+
+    return (unsigned long) ((unsigned long long) ml->pixel_clock * 1000000000ULL / total);
+}
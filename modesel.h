@@ -0,0 +1,46 @@
+/*
+ * modesel.h - memory bandwidth aware video mode selection
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef MODESEL_H
+#define MODESEL_H
+
+#include "modeline.h"
+
+/*
+ * limits the selector works against. Scanout and CPU share the FireBee video RAM,
+ * so a mode is only acceptable if its scanout leaves cpu_headroom percent of
+ * vram_bandwidth for drawing
+ */
+struct modesel_config
+{
+    unsigned long vram_bandwidth;   /* usable video RAM bandwidth in bytes/s */
+    short cpu_headroom;             /* percentage of vram_bandwidth to keep free for the CPU */
+    short min_refresh;              /* refresh rate range (Hz) to search */
+    short max_refresh;
+    short min_pixel_clock;          /* video PLL range (MHz) */
+    short max_pixel_clock;
+};
+
+extern struct modesel_config modesel_config;
+
+struct modesel_result
+{
+    struct modeline modeline;
+    short refresh;                  /* selected refresh rate (Hz) */
+    unsigned long actual_refresh;   /* refresh rate the integer MHz PLL really produces (mHz) */
+    short reduced_blanking;         /* 0: GTF timing, 1: CVT reduced blanking timing */
+    unsigned long scanout_bandwidth;    /* bytes/s fetched by the video scanout */
+    unsigned long free_bandwidth;   /* bytes/s left for drawing */
+};
+
+unsigned long modesel_scanout_bandwidth(const struct modeline *ml, short bpp);
+unsigned long modesel_actual_refresh(const struct modeline *ml);
+/* build time only (modesel_search.c), these need modeline.c */
+int modesel_select(short width, short height, short bpp, struct modesel_result *result);
+int modesel_optimize_clock(short width, short height, short bpp, short refresh, struct modesel_result *result);
+
+#endif /* MODESEL_H */
@@ -0,0 +1,191 @@
+/*
+ * modesel_search.c - search the timing that fits the video RAM bandwidth
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modesel.h"
+
+/*
+ * The searches run at build time (mkmodes.c) only: they try CVT timing, which
+ * needs the floating point calculations of modeline.c. The driver just links
+ * the bandwidth and refresh helpers of modesel.c.
+ */
+
+static int mode_fits(const struct modeline *ml, short bpp, unsigned long budget, unsigned long *bandwidth)
+{
+    if (ml->pixel_clock < modesel_config.min_pixel_clock || ml->pixel_clock > modesel_config.max_pixel_clock)
+        return 0;
+
+    *bandwidth = modesel_scanout_bandwidth(ml, bpp);
+
+    return *bandwidth <= budget;
+}
+
+/*
+ * find the highest refresh rate for <width> x <height> x <bpp> that fits into the
+ * configured video RAM budget. At each refresh rate, GTF timing is tried first and
+ * CVT reduced blanking (lower pixel clock and fetch rate) second.
+ * Returns 0 and fills <result> on success, -1 if no refresh rate fits.
+ */
+int modesel_select(short width, short height, short bpp, struct modesel_result *result)
+{
+    unsigned long budget = modesel_config.vram_bandwidth / 100 * (100 - modesel_config.cpu_headroom);
+
+    width &= ~7;
+
+    for (short refresh = modesel_config.max_refresh; refresh >= modesel_config.min_refresh; refresh--)
+    {
+        struct modeline ml;
+        unsigned long bandwidth;
+        short reduced_blanking;
+
+        general_timing_formula_fixed(&gtf_default_display, width, height, refresh, 0, &ml);
+        reduced_blanking = 0;
+
+        if (!mode_fits(&ml, bpp, budget, &bandwidth))
+        {
+            coordinated_video_timing(width, height, refresh, 0, 1, &ml);
+            reduced_blanking = 1;
+
+            if (!mode_fits(&ml, bpp, budget, &bandwidth))
+                continue;
+        }
+
+        result->modeline = ml;
+        result->refresh = refresh;
+        result->actual_refresh = modesel_actual_refresh(&ml);
+        result->reduced_blanking = reduced_blanking;
+        result->scanout_bandwidth = bandwidth;
+        result->free_bandwidth = modesel_config.vram_bandwidth - bandwidth;
+
+        return 0;
+    }
+
+    return -1;
+}
+
+/*
+ * GTF rounds to a fractional pixel clock, the PLL then truncates it to whole MHz and
+ * the refresh rate drifts off (640x480@60 comes out at 57.8 Hz). Instead, keep the
+ * pixel clock an integer number of MHz and stretch or shrink h_total and v_total
+ * around the GTF values until the refresh rate fits:
+ *
+ *  - h_total in character cells, between CVT reduced blanking (the least
+ *    blanking a monitor is expected to cope with, unless the GTF wants even
+ *    less) and GTF blanking plus OPT_H_SLACK
+ *  - v_total between the minimum front porch + sync + back porch and the GTF
+ *    value plus OPT_V_SLACK
+ *  - sync widths as calculated by the GTF, porches split as the GTF does
+ *
+ * The candidate with the smallest refresh error wins, ties go to the lower pixel
+ * clock (lower peak fetch rate).
+ * Returns 0 and fills <result> on success, -1 if no candidate passes the PLL and
+ * video RAM limits
+ */
+#define OPT_H_SLACK     10      /* percent */
+#define OPT_V_SLACK     5       /* percent */
+#define OPT_CLOCK_RANGE 20      /* percent around the GTF pixel clock */
+
+int modesel_optimize_clock(short width, short height, short bpp, short refresh, struct modesel_result *result)
+{
+    const struct display_fixed *dsp = &gtf_default_display;
+    unsigned long budget = modesel_config.vram_bandwidth / 100 * (100 - modesel_config.cpu_headroom);
+    unsigned long long target = (unsigned long long) refresh * 1000;       /* mHz */
+    unsigned long long best_error = ~0ULL;
+    struct modeline gtf;
+    struct modeline best;
+    int h_sync_width;
+    int v_sync_width;
+    int h_min, h_max;
+    int v_min, v_max;
+    int clock_min, clock_max;
+
+    width &= ~7;
+
+    general_timing_formula_fixed(dsp, width, height, refresh, 0, &gtf);
+
+    h_sync_width = gtf.h_sync_end - gtf.h_sync_start;
+    v_sync_width = gtf.v_sync_end - gtf.v_sync_start;
+
+    h_min = gtf.h_display + dsp->HBlankingTicks;
+    if (h_min > gtf.h_total)
+        h_min = gtf.h_total;
+    if (h_min < gtf.h_display + h_sync_width + 2 * dsp->CharacterCell)
+        h_min = gtf.h_display + h_sync_width + 2 * dsp->CharacterCell;
+    h_max = gtf.h_total + gtf.h_total * OPT_H_SLACK / 100;
+
+    v_min = gtf.v_display + dsp->VFrontPorch + v_sync_width + dsp->VBackPorch;
+    v_max = gtf.v_total + gtf.v_total * OPT_V_SLACK / 100;
+
+    clock_min = gtf.pixel_clock - gtf.pixel_clock * OPT_CLOCK_RANGE / 100;
+    if (clock_min < modesel_config.min_pixel_clock)
+        clock_min = modesel_config.min_pixel_clock;
+    clock_max = gtf.pixel_clock + 1 + gtf.pixel_clock * OPT_CLOCK_RANGE / 100;
+    if (clock_max > modesel_config.max_pixel_clock)
+        clock_max = modesel_config.max_pixel_clock;
+
+    for (int clock = clock_min; clock <= clock_max; clock++)
+    {
+        for (int h_total = h_min; h_total <= h_max; h_total += dsp->CharacterCell)
+        {
+            unsigned long long pixels_per_frame = (unsigned long long) clock * 1000000000ULL / target;
+            int v_total = (int) ((pixels_per_frame + h_total / 2) / h_total);
+            struct modeline ml;
+            unsigned long long actual;
+            unsigned long long error;
+            int h_back_porch;
+
+            if (v_total < v_min || v_total > v_max)
+                continue;
+
+            actual = (unsigned long long) clock * 1000000000ULL / ((unsigned long long) h_total * v_total);
+            error = actual > target ? actual - target : target - actual;
+            if (error >= best_error)
+                continue;
+
+            h_back_porch = (h_total - gtf.h_display) / 2 / dsp->CharacterCell * dsp->CharacterCell;
+
+            ml = gtf;
+            ml.pixel_clock = clock;
+            ml.h_total = h_total;
+            ml.h_sync_end = h_total - h_back_porch;
+            ml.h_sync_start = ml.h_sync_end - h_sync_width;
+            ml.v_total = v_total;
+
+            if (ml.h_sync_start < ml.h_display + dsp->CharacterCell)
+                continue;
+
+            if (modesel_scanout_bandwidth(&ml, bpp) > budget)
+                continue;
+
+            best = ml;
+            best_error = error;
+        }
+    }
+
+    if (best_error == ~0ULL)
+        return -1;
+
+    result->modeline = best;
+    result->refresh = refresh;
+    result->actual_refresh = modesel_actual_refresh(&best);
+    result->reduced_blanking = 0;
+    result->scanout_bandwidth = modesel_scanout_bandwidth(&best, bpp);
+    result->free_bandwidth = modesel_config.vram_bandwidth - result->scanout_bandwidth;
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * modetab.h - precalculated video mode table
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef MODETAB_H
+#define MODETAB_H
+
+#include "modeline.h"
+#include "videl.h"
+
+/*
+ * one finished video mode. The table (modetab.c) is generated by mkmodes at
+ * build time, so nothing of the timing calculation needs to be linked to the driver
+ */
+struct modetab_entry
+{
+    short width;
+    short height;
+    short bpp;
+    short freq;
+    struct modeline modeline;
+    struct videl_timing videl;
+};
+
+extern const struct modetab_entry modetab[];
+extern const short modetab_size;
+
+#endif /* MODETAB_H */
@@ -0,0 +1,124 @@
+/*
+ * pan.c - hardware panning over a virtual screen
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pan.h"
+#include "videl.h"
+#include "fb_video.h"
+
+/*
+ * The virtual screen is a surface larger than the display. VWRAP is set to
+ * its line length, so the display shows a window into it, and moving the
+ * window only takes a new base address: vertically in lines, horizontally in
+ * groups of 16 pixels, with HSCROLL shifting the display by the remaining
+ * 0..15 pixels. No pixel data is moved.
+ *
+ * The registers go through the VIDEL shadow state, so they are written from
+ * its commit job during vertical blank, never in the middle of a frame.
+ */
+static struct vram_surface virtual_screen;
+static short display_width;
+static short display_height;
+static short pan_x;
+static short pan_y;
+
+/*
+ * allocate a <virtual_width> x <virtual_height> x <bpp> surface from the video
+ * RAM arena and show its top left <width> x <height> corner (the current video
+ * mode). Needs supervisor mode
+ */
+int pan_init(short virtual_width, short virtual_height, short bpp, short width, short height)
+{
+    if (virtual_width < width || virtual_height < height)
+        return -1;
+
+    if (vram_pitch(virtual_width, bpp) / 2 > PAN_MAX_LINE_WORDS)
+        return -1;
+
+    if (vram_alloc_surface(&virtual_screen, virtual_width, virtual_height, bpp) != 0)
+        return -1;
+
+    display_width = width;
+    display_height = height;
+
+    videl_stage_line(virtual_screen.pitch / 2);
+    pan_x = pan_y = -1;
+    pan_to(0, 0);
+
+    return 0;
+}
+
+/*
+ * back to a line stride that matches the display. The surface is freed,
+ * so a new screen base needs to be set. Needs supervisor mode
+ */
+void pan_exit(void)
+{
+    videl_stage_line(vram_pitch(display_width, virtual_screen.bpp) / 2);
+    videl_stage_hscroll(0);
+    videl_commit_start();
+    videl_commit_wait();
+
+    vram_free_surface(&virtual_screen);
+}
+
+struct vram_surface *pan_surface(void)
+{
+    return &virtual_screen;
+}
+
+/*
+ * show the window with the top left corner at <x>, <y> of the virtual screen
+ * from the next frame on. Coordinates are clipped. Needs supervisor mode
+ */
+void pan_to(short x, short y)
+{
+    short bits = fb_pixel_bits(virtual_screen.bpp);
+    char *base;
+
+    if (x > virtual_screen.width - display_width)
+        x = virtual_screen.width - display_width;
+    if (x < 0)
+        x = 0;
+    if (y > virtual_screen.height - display_height)
+        y = virtual_screen.height - display_height;
+    if (y < 0)
+        y = 0;
+
+    if (x == pan_x && y == pan_y)
+        return;
+
+    pan_x = x;
+    pan_y = y;
+
+    base = (char *) virtual_screen.addr + (long) y * virtual_screen.pitch + (long) (x & ~15) * bits / 8;
+    videl_stage_base(base + FB_VRAM_PHYS_OFFSET);
+    videl_stage_hscroll(x & 15);
+    videl_commit_start();
+}
+
+void pan_by(short dx, short dy)
+{
+    pan_to(pan_x + dx, pan_y + dy);
+}
+
+void pan_position(short *x, short *y)
+{
+    *x = pan_x;
+    *y = pan_y;
+}
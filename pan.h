@@ -0,0 +1,22 @@
+/*
+ * pan.h - hardware panning over a virtual screen
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef PAN_H
+#define PAN_H
+
+#include "vram.h"
+
+#define PAN_MAX_LINE_WORDS  1023        /* VWRAP is 10 bits wide */
+
+int pan_init(short virtual_width, short virtual_height, short bpp, short width, short height);
+void pan_exit(void);
+struct vram_surface *pan_surface(void);
+void pan_to(short x, short y);
+void pan_by(short dx, short dy);
+void pan_position(short *x, short *y);
+
+#endif /* PAN_H */
@@ -0,0 +1,402 @@
+/*
+ * pixel.c - depth specialized software drawing kernels
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pixel.h"
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Fills and copies of 8 bpp and up are reduced to runs of bytes that are split
+ * into a head (up to the next wide word boundary), an unrolled body of wide
+ * stores and a tail. On the ColdFire a wide word is a long, which is what the
+ * bus does in one cycle anyway. Host builds use 16 byte vectors if the compiler
+ * has them, so the same kernels can be measured there.
+ *
+ * 1 bpp is MSB first, 16 and 32 bpp pixels are stored in native byte order.
+ */
+#if defined(__SSE2__) || defined(__ARM_NEON)
+typedef uint32_t wide_t __attribute__((vector_size(16), may_alias));
+#else
+typedef uint32_t wide_t __attribute__((may_alias));
+#endif
+
+typedef uint32_t long_t __attribute__((may_alias));
+typedef uint16_t word_t __attribute__((may_alias));
+
+#define WIDE        sizeof(wide_t)
+#define UNROLL      4
+
+static inline int misaligned(const void *p, size_t align)
+{
+    return ((uintptr_t) p & (align - 1)) != 0;
+}
+
+/*
+ * store <n> bytes of the 32 bit <pattern> to the long aligned <p>. <n> is a
+ * multiple of the pixel size, and <pattern> holds a whole number of pixels
+ */
+static void fill_longs(uint8_t *p, long n, uint32_t pattern)
+{
+    wide_t wide = (wide_t) {0} + pattern;
+    wide_t *w;
+
+    /* head */
+    while (n >= 4 && misaligned(p, WIDE))
+    {
+        *(long_t *) p = pattern;
+        p += 4;
+        n -= 4;
+    }
+
+    /* body */
+    w = (wide_t *) p;
+    for (; n >= UNROLL * (long) WIDE; n -= UNROLL * WIDE)
+    {
+        w[0] = wide;
+        w[1] = wide;
+        w[2] = wide;
+        w[3] = wide;
+        w += UNROLL;
+    }
+    for (; n >= (long) WIDE; n -= WIDE)
+        *w++ = wide;
+    p = (uint8_t *) w;
+
+    /* tail */
+    for (; n >= 4; n -= 4, p += 4)
+        *(long_t *) p = pattern;
+    if (n >= 2)
+    {
+        *(word_t *) p = pattern;
+        p += 2;
+        n -= 2;
+    }
+    if (n)
+        *p = pattern;
+}
+
+/*
+ * forward copy of <n> bytes. Runs the wide loop only if source and destination
+ * can be aligned together, otherwise leaves it to memmove()
+ */
+static void copy_bytes(uint8_t *dst, const uint8_t *src, long n)
+{
+    const wide_t *s;
+    wide_t *d;
+
+    if (((uintptr_t) dst ^ (uintptr_t) src) & (WIDE - 1))
+    {
+        memmove(dst, src, n);
+        return;
+    }
+
+    for (; n > 0 && misaligned(dst, WIDE); n--)
+        *dst++ = *src++;
+
+    d = (wide_t *) dst;
+    s = (const wide_t *) src;
+    for (; n >= UNROLL * (long) WIDE; n -= UNROLL * WIDE)
+    {
+        wide_t a = s[0], b = s[1], c = s[2], e = s[3];
+
+        d[0] = a;
+        d[1] = b;
+        d[2] = c;
+        d[3] = e;
+        d += UNROLL;
+        s += UNROLL;
+    }
+    for (; n >= (long) WIDE; n -= WIDE)
+        *d++ = *s++;
+
+    dst = (uint8_t *) d;
+    src = (const uint8_t *) s;
+    while (n-- > 0)
+        *dst++ = *src++;
+}
+
+/*
+ * copy for chunky depths. Copies within a line towards the right would
+ * overwrite their own source going forward
+ */
+static void copy_chunky(uint8_t *dst, const uint8_t *src, long n)
+{
+    if (dst > src && dst < src + n)
+        memmove(dst, src, n);
+    else
+        copy_bytes(dst, src, n);
+}
+
+/* head up to the next long for byte and word pixels, then long stores */
+static void fill_chunky(uint8_t *p, long n, uint32_t pattern)
+{
+    if ((uintptr_t) p & 1 && n > 0)
+    {
+        *p++ = pattern;
+        n--;
+    }
+    if ((uintptr_t) p & 2 && n >= 2)
+    {
+        *(word_t *) p = pattern;
+        p += 2;
+        n -= 2;
+    }
+    fill_longs(p, n, pattern);
+}
+
+/* 1 bpp */
+
+static void fill_span_1(uint8_t *line, short x, short w, uint32_t color)
+{
+    uint8_t pattern = color & 1 ? 0xff : 0;
+    uint8_t *p = line + x / 8;
+    short end = x + w - 1;
+    uint8_t left = 0xff >> (x % 8);
+    uint8_t right = 0xff << (7 - end % 8);
+    long bytes = end / 8 - x / 8 - 1;
+
+    if (bytes < 0)
+    {
+        left &= right;
+        *p = (*p & ~left) | (pattern & left);
+        return;
+    }
+
+    *p = (*p & ~left) | (pattern & left);
+    p++;
+    fill_chunky(p, bytes, pattern * 0x01010101u);
+    p += bytes;
+    *p = (*p & ~right) | (pattern & right);
+}
+
+/* merge <n> bits from bit <sbit> of <src> into <dst> at bit <dbit> of the byte */
+static inline void copy_bits(uint8_t *dst, short dbit, const uint8_t *src, long sbit, short n)
+{
+    uint16_t word = src[sbit / 8] << 8;
+    uint8_t mask = ((1 << n) - 1) << (8 - dbit - n);
+    uint8_t bits;
+
+    if (sbit % 8 + n > 8)
+        word |= src[sbit / 8 + 1];
+    bits = ((word >> (16 - sbit % 8 - n)) & ((1 << n) - 1)) << (8 - dbit - n);
+
+    *dst = (*dst & ~mask) | bits;
+}
+
+/*
+ * walks the destination byte by byte, pulling the matching bits out of the
+ * source. Goes right to left if the destination is behind an overlapping source.
+ * With the same bit offset on both sides, whole bytes go the chunky way
+ */
+static void copy_span_1(uint8_t *dst, short dx, const uint8_t *src, short sx, short w)
+{
+    short first = dx / 8;
+    short last = (dx + w - 1) / 8;
+    int backwards = (dst - src) * 8 + dx - sx > 0;
+
+    if (dx % 8 == sx % 8 && last - first > 1)
+    {
+        short tail = (dx + w - 1) % 8 + 1;
+
+        if (backwards)
+            copy_bits(dst + last, 0, src, (long) sx + w - tail, tail);
+        else
+            copy_bits(dst + first, dx % 8, src, sx, 8 - dx % 8);
+
+        copy_chunky(dst + first + 1, src + sx / 8 + 1, last - first - 1);
+
+        if (backwards)
+            copy_bits(dst + first, dx % 8, src, sx, 8 - dx % 8);
+        else
+            copy_bits(dst + last, 0, src, (long) sx + w - tail, tail);
+        return;
+    }
+
+    for (short i = 0; i <= last - first; i++)
+    {
+        short b = backwards ? last - i : first + i;
+        short from = b == first ? dx % 8 : 0;
+        short to = b == last ? (dx + w - 1) % 8 : 7;
+
+        copy_bits(dst + b, from, src, (long) sx + b * 8 + from - dx, to - from + 1);
+    }
+}
+
+static void put_1(uint8_t *line, short x, uint32_t color)
+{
+    uint8_t bit = 0x80 >> (x % 8);
+
+    if (color & 1)
+        line[x / 8] |= bit;
+    else
+        line[x / 8] &= ~bit;
+}
+
+static uint32_t get_1(const uint8_t *line, short x)
+{
+    return (line[x / 8] >> (7 - x % 8)) & 1;
+}
+
+/* 8 bpp */
+
+static void fill_span_8(uint8_t *line, short x, short w, uint32_t color)
+{
+    fill_chunky(line + x, w, (color & 0xff) * 0x01010101u);
+}
+
+static void copy_span_8(uint8_t *dst, short dx, const uint8_t *src, short sx, short w)
+{
+    copy_chunky(dst + dx, src + sx, w);
+}
+
+static void put_8(uint8_t *line, short x, uint32_t color)
+{
+    line[x] = color;
+}
+
+static uint32_t get_8(const uint8_t *line, short x)
+{
+    return line[x];
+}
+
+/* 16 bpp */
+
+static void fill_span_16(uint8_t *line, short x, short w, uint32_t color)
+{
+    fill_chunky(line + 2 * x, 2L * w, (color & 0xffff) * 0x00010001u);
+}
+
+static void copy_span_16(uint8_t *dst, short dx, const uint8_t *src, short sx, short w)
+{
+    copy_chunky(dst + 2 * dx, src + 2 * sx, 2L * w);
+}
+
+static void put_16(uint8_t *line, short x, uint32_t color)
+{
+    ((word_t *) line)[x] = color;
+}
+
+static uint32_t get_16(const uint8_t *line, short x)
+{
+    return ((const word_t *) line)[x];
+}
+
+/* 24 bpp, stored as 32 bit xRGB */
+
+static void fill_span_32(uint8_t *line, short x, short w, uint32_t color)
+{
+    fill_longs(line + 4 * x, 4L * w, color);
+}
+
+static void copy_span_32(uint8_t *dst, short dx, const uint8_t *src, short sx, short w)
+{
+    copy_chunky(dst + 4 * dx, src + 4 * sx, 4L * w);
+}
+
+static void put_32(uint8_t *line, short x, uint32_t color)
+{
+    ((long_t *) line)[x] = color;
+}
+
+static uint32_t get_32(const uint8_t *line, short x)
+{
+    return ((const long_t *) line)[x];
+}
+
+static const struct pixel_ops ops[] =
+{
+    { 1, fill_span_1, copy_span_1, put_1, get_1 },
+    { 8, fill_span_8, copy_span_8, put_8, get_8 },
+    { 16, fill_span_16, copy_span_16, put_16, get_16 },
+    { 24, fill_span_32, copy_span_32, put_32, get_32 },
+};
+
+/*
+ * the kernels for <bpp>, NULL for depths we don't draw in
+ */
+const struct pixel_ops *pixel_ops(short bpp)
+{
+    for (unsigned i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        if (ops[i].bpp == bpp)
+            return &ops[i];
+
+    return NULL;
+}
+
+static uint8_t *line_addr(struct vram_surface *s, short y)
+{
+    return (uint8_t *) s->addr + (long) y * s->pitch;
+}
+
+void pixel_fill_span(struct vram_surface *s, short x, short y, short w, uint32_t color)
+{
+    if (w > 0)
+        pixel_ops(s->bpp)->fill_span(line_addr(s, y), x, w, color);
+}
+
+void pixel_fill_rect(struct vram_surface *s, short x, short y, short w, short h, uint32_t color)
+{
+    const struct pixel_ops *o = pixel_ops(s->bpp);
+    uint8_t *line = line_addr(s, y);
+
+    if (w <= 0)
+        return;
+
+    for (; h > 0; h--, line += s->pitch)
+        o->fill_span(line, x, w, color);
+}
+
+/*
+ * copy a rectangle between (or within) surfaces of the same depth. Overlapping
+ * rectangles are handled
+ */
+void pixel_copy_rect(struct vram_surface *src, short sx, short sy,
+                     struct vram_surface *dst, short dx, short dy, short w, short h)
+{
+    const struct pixel_ops *o = pixel_ops(dst->bpp);
+    const uint8_t *s = line_addr(src, sy);
+    uint8_t *d = line_addr(dst, dy);
+    long spitch = src->pitch;
+    long dpitch = dst->pitch;
+
+    if (w <= 0 || h <= 0)
+        return;
+
+    /* overlapping copy down: go bottom up */
+    if (src->addr == dst->addr && dy > sy)
+    {
+        s += (h - 1) * spitch;
+        d += (h - 1) * dpitch;
+        spitch = -spitch;
+        dpitch = -dpitch;
+    }
+
+    for (; h > 0; h--, s += spitch, d += dpitch)
+        o->copy_span(d, dx, s, sx, w);
+}
+
+void pixel_put(struct vram_surface *s, short x, short y, uint32_t color)
+{
+    pixel_ops(s->bpp)->put(line_addr(s, y), x, color);
+}
+
+uint32_t pixel_get(struct vram_surface *s, short x, short y)
+{
+    return pixel_ops(s->bpp)->get(line_addr(s, y), x);
+}
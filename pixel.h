@@ -0,0 +1,36 @@
+/*
+ * pixel.h - depth specialized software drawing kernels
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef PIXEL_H
+#define PIXEL_H
+
+#include <stdint.h>
+#include "vram.h"
+
+/*
+ * the kernels for one depth. <line> is the start of a surface line, <color>
+ * a pixel value of that depth (0x00RRGGBB for 24 bpp)
+ */
+struct pixel_ops
+{
+    short bpp;
+    void (*fill_span)(uint8_t *line, short x, short w, uint32_t color);
+    void (*copy_span)(uint8_t *dst, short dx, const uint8_t *src, short sx, short w);
+    void (*put)(uint8_t *line, short x, uint32_t color);
+    uint32_t (*get)(const uint8_t *line, short x);
+};
+
+const struct pixel_ops *pixel_ops(short bpp);
+
+void pixel_fill_span(struct vram_surface *s, short x, short y, short w, uint32_t color);
+void pixel_fill_rect(struct vram_surface *s, short x, short y, short w, short h, uint32_t color);
+void pixel_copy_rect(struct vram_surface *src, short sx, short sy,
+                     struct vram_surface *dst, short dx, short dy, short w, short h);
+void pixel_put(struct vram_surface *s, short x, short y, uint32_t color);
+uint32_t pixel_get(struct vram_surface *s, short x, short y);
+
+#endif /* PIXEL_H */
@@ -0,0 +1,155 @@
+/*
+ * pixelbench.c - throughput of the software drawing kernels
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pixel.h"
+#include "fb_video.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Built for the FireBee, the surfaces are in video RAM and the benchmark runs
+ * in supervisor mode, for the 200 Hz system timer (see bench.c). The host
+ * build (make pixelbench) measures the same kernels on ordinary memory.
+ */
+#ifdef __MINT__
+#include <osbind.h>
+#endif
+
+#define BENCH_WIDTH     1280
+#define BENCH_HEIGHT    256
+#define BENCH_TIME      (bench_ticks_per_second() / 2)  /* minimum time per test */
+
+static const short depths[] = { 1, 8, 16, 24 };
+static const short widths[] = { 8, 64, 320, 640, 1280 };
+
+#define NUM_DEPTHS  (sizeof(depths) / sizeof(depths[0]))
+#define NUM_WIDTHS  (sizeof(widths) / sizeof(widths[0]))
+
+enum bench_op { BENCH_FILL, BENCH_COPY, BENCH_PUT, NUM_OPS };
+
+static const char * const op_names[NUM_OPS] = { "fill", "copy", "put" };
+
+/* Mbytes per second, [op][depth][width] */
+static double result[NUM_OPS][NUM_DEPTHS][NUM_WIDTHS];
+
+static struct vram_surface src;
+static struct vram_surface dst;
+
+/*
+ * run <op> on <w> pixel wide spans over the whole surface height until
+ * BENCH_TIME has passed, return the throughput in Mbytes/s
+ */
+static double bench(enum bench_op op, short w)
+{
+    long bytes = ((long) w * fb_pixel_bits(dst.bpp) + 7) / 8 * BENCH_HEIGHT;
+    long reps = 0;
+    uint32_t start;
+    uint32_t t;
+
+    start = bench_ticks();
+    do
+    {
+        switch (op)
+        {
+            case BENCH_FILL:
+                pixel_fill_rect(&dst, 0, 0, w, BENCH_HEIGHT, reps);
+                break;
+
+            case BENCH_COPY:
+                /* odd destination x, so the head/tail code is part of the measurement */
+                pixel_copy_rect(&src, 0, 0, &dst, 1, 0, w - 1, BENCH_HEIGHT);
+                break;
+
+            default:
+                for (short y = 0; y < BENCH_HEIGHT; y++)
+                    for (short x = 0; x < w; x++)
+                        pixel_put(&dst, x, y, reps);
+                break;
+        }
+        reps++;
+    } while ((t = bench_ticks() - start) < BENCH_TIME);
+
+    return (double) bytes * reps * bench_ticks_per_second() / t / 1e6;
+}
+
+static long run_benchmarks(void)
+{
+    for (short d = 0; d < NUM_DEPTHS; d++)
+    {
+        src.bpp = dst.bpp = depths[d];
+        src.pitch = dst.pitch = vram_pitch(BENCH_WIDTH, depths[d]);
+
+        for (short w = 0; w < NUM_WIDTHS; w++)
+            for (short op = 0; op < NUM_OPS; op++)
+                result[op][d][w] = bench(op, widths[w]);
+    }
+
+    return 0;
+}
+
+#ifdef __MINT__
+static int alloc_surfaces(void)
+{
+    long size = vram_surface_size(BENCH_WIDTH, BENCH_HEIGHT, 24);
+
+    if (vram_init(2 * size) != 0 ||
+        vram_alloc_surface(&src, BENCH_WIDTH, BENCH_HEIGHT, 24) != 0 ||
+        vram_alloc_surface(&dst, BENCH_WIDTH, BENCH_HEIGHT, 24) != 0)
+        return -1;
+
+    return 0;
+}
+
+#define run()       Supexec(run_benchmarks)
+#define free_surfaces() vram_exit()
+#else
+static int alloc_surfaces(void)
+{
+    long size = vram_pitch(BENCH_WIDTH, 24) * BENCH_HEIGHT;
+
+    src.addr = malloc(size);
+    dst.addr = malloc(size);
+
+    return src.addr && dst.addr ? 0 : -1;
+}
+
+#define run()       run_benchmarks()
+#define free_surfaces() (free(src.addr), free(dst.addr))
+#endif
+
+int main(int argc, char *argv[])
+{
+    if (alloc_surfaces() != 0)
+    {
+        fprintf(stderr, "%s: could not allocate benchmark surfaces\r\n", argv[0]);
+        exit(1);
+    }
+
+    run();
+    free_surfaces();
+
+    printf("op   bpp  width       MB/s\r\n");
+    for (short op = 0; op < NUM_OPS; op++)
+        for (short d = 0; d < NUM_DEPTHS; d++)
+            for (short w = 0; w < NUM_WIDTHS; w++)
+                printf("%-4s %3d %6d %10.1f\r\n", op_names[op], depths[d], widths[w], result[op][d][w]);
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * pll.c - FireBee video PLL handling
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pll.h"
+#include "fb_video.h"
+#include "trace.h"
+#include "sysvars.h"
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Changing the pixel clock takes a while: the PLL needs to be idle before it
+ * takes a new frequency, again before reconfiguration can be triggered, and
+ * then reconfiguration itself runs for some time. Instead of spinning through
+ * all of that, pll_start() kicks it off and pll_poll() advances it as far as
+ * the hardware allows without waiting, so the caller can do other setup work
+ * in between. Every step is bounded by PLL_TIMEOUT_TICKS.
+ */
+static enum pll_state state = PLL_IDLE;
+static unsigned short frequency;
+static pll_callback done_callback;
+static uint32_t step_start;
+static short busy_seen;             /* reconfiguration has been seen running */
+
+static void fbee_set_clockmode(enum fb_clockmode mode)
+{
+    if (!(mode <= FB_CLOCK_PLL))
+    {
+        puts("error: illegal clock mode\r\n");
+        for (;;);
+    }
+
+    REG_WRITE(*fb_vd_cntrl, (*fb_vd_cntrl & ~(FB_CLOCK_MASK << 8)) | mode << 8);
+}
+
+/*
+ * the Firebee clock generator signals busy with the sign bit of the reconfig register
+ */
+static int pll_busy(void)
+{
+    return *fb_vd_pll_reconfig < 0;
+}
+
+static void next_state(enum pll_state new_state)
+{
+    state = new_state;
+    step_start = hz_200;
+    busy_seen = 0;
+
+    if ((state == PLL_DONE || state == PLL_TIMEOUT) && done_callback != NULL)
+        done_callback(state);
+}
+
+/*
+ * start switching the Firebee video (pixel) clock to <clock> MHz. <callback> (may be
+ * NULL) is called from pll_poll() once the PLL is done or timed out.
+ * Returns -1 if a reconfiguration is still running
+ */
+int pll_start(unsigned short clock, pll_callback callback)
+{
+    if (state != PLL_IDLE && state != PLL_DONE && state != PLL_TIMEOUT)
+        return -1;
+
+    fbee_set_clockmode(FB_CLOCK_PLL);
+
+    frequency = clock;
+    done_callback = callback;
+    next_state(PLL_WAIT_READY);
+    pll_poll();
+
+    return 0;
+}
+
+enum pll_state pll_poll(void)
+{
+    for (;;)
+    {
+        switch (state)
+        {
+            case PLL_WAIT_READY:
+                if (pll_busy())
+                    break;
+                REG_WRITE(*fb_vd_frq, frequency - 1);
+                next_state(PLL_WAIT_FREQUENCY);
+                continue;
+
+            case PLL_WAIT_FREQUENCY:
+                if (pll_busy())
+                    break;
+                REG_WRITE(*fb_vd_pll_reconfig, 0);
+                next_state(PLL_RECONFIG);
+                continue;
+
+            case PLL_RECONFIG:
+                /*
+                 * the busy bit may come up a little after the trigger. Idle only
+                 * counts once it has been seen busy, or a timer tick has passed
+                 */
+                if (pll_busy())
+                {
+                    busy_seen = 1;
+                    break;
+                }
+                if (!busy_seen && hz_200 == step_start)
+                    break;
+                next_state(PLL_DONE);
+                continue;
+
+            default:
+                return state;
+        }
+
+        /* hardware still busy */
+        if (hz_200 - step_start > PLL_TIMEOUT_TICKS)
+            next_state(PLL_TIMEOUT);
+
+        return state;
+    }
+}
+
+/*
+ * wait for the reconfiguration started with pll_start() to finish.
+ * Returns 0 on success, -1 on timeout
+ */
+int pll_wait(void)
+{
+    enum pll_state st;
+
+    do
+    {
+        st = pll_poll();
+    } while (st != PLL_DONE && st != PLL_TIMEOUT && st != PLL_IDLE);
+
+    return st == PLL_TIMEOUT ? -1 : 0;
+}
+
+/*
+ * set the Firebee video (pixel) clock to <clock> MHz and wait for it.
+ * Returns 0 on success, -1 if the PLL didn't respond in time
+ */
+int fbee_set_clock(unsigned short clock)
+{
+    /* let a reconfiguration that is still running finish first */
+    pll_wait();
+
+    if (pll_start(clock, NULL) != 0)
+        return -1;
+
+    return pll_wait();
+}
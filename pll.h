@@ -0,0 +1,30 @@
+/*
+ * pll.h - FireBee video PLL handling
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef PLL_H
+#define PLL_H
+
+#define PLL_TIMEOUT_TICKS   20      /* 200 Hz timer ticks to wait for the PLL (100 ms) */
+
+enum pll_state
+{
+    PLL_IDLE,
+    PLL_WAIT_READY,                 /* waiting for the PLL to accept a new frequency */
+    PLL_WAIT_FREQUENCY,             /* frequency written, waiting to trigger reconfiguration */
+    PLL_RECONFIG,                   /* reconfiguration running */
+    PLL_DONE,
+    PLL_TIMEOUT
+};
+
+typedef void (*pll_callback)(enum pll_state state);
+
+/* these need supervisor mode */
+int pll_start(unsigned short clock, pll_callback callback);
+enum pll_state pll_poll(void);
+int pll_wait(void);
+
+#endif /* PLL_H */
@@ -0,0 +1,257 @@
+/*
+ * sched.c - vertical blank frame scheduler
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "sched.h"
+#include "vbl.h"
+#include "pixel.h"
+#include "modesel.h"
+#include <stddef.h>
+
+/*
+ * Everything that has to happen during vertical blank - VIDEL commits, page
+ * flips, CLUT uploads and deferred drawing work such as clears - is queued as
+ * jobs, sorted by priority, and run from the VBL hook below. Each frame gets a budget of CPU cycles worth SCHED_BUDGET_PERCENT of the
+ * vertical blanking time of the current mode. Jobs run in priority order as
+ * long as their estimated cost fits; the first job that doesn't stops the
+ * frame and everything from there on waits for the next one. Incremental
+ * jobs instead do whatever fits and stay queued with the rest of the work.
+ *
+ * There is no cycle counter to measure what a job really took, so the
+ * accounting relies on the estimates the jobs give for themselves.
+ */
+static struct sched_job *queue;
+static uint32_t frame_budget;      /* 0: timing unknown, run everything */
+static volatile short locked;
+static short vbl_hooked;
+
+static void dequeue(struct sched_job **link)
+{
+    struct sched_job *job = *link;
+
+    *link = job->next;
+    job->next = NULL;
+    job->queued = 0;
+}
+
+static void sched_vbl(void)
+{
+    struct sched_job **link = &queue;
+    uint32_t left = frame_budget;
+    short first = 1;
+
+    /* somebody is just changing the queue - try again next frame */
+    if (locked)
+        return;
+
+    while (*link != NULL)
+    {
+        struct sched_job *job = *link;
+        uint32_t cost = job->cost;
+        uint32_t budget;
+        uint32_t remaining;
+        uint32_t used;
+
+        if (frame_budget == 0)
+            budget = UINT32_MAX;
+        else if (cost <= left || job->incremental)
+            budget = left;
+        else if (first)
+            budget = cost;      /* never fits - overrun this frame rather than starve */
+        else
+            break;
+
+        if (budget == 0)
+            break;
+
+        remaining = job->func(job, budget);
+        first = 0;
+
+        used = cost > remaining ? cost - remaining : 0;
+        left = used < left ? left - used : 0;
+
+        if (remaining != 0)
+        {
+            /* keep the order: nothing behind an unfinished job may overtake it */
+            job->cost = remaining;
+            break;
+        }
+        dequeue(link);
+    }
+}
+
+void sched_job_init(struct sched_job *job, sched_func func, void *arg, short priority)
+{
+    job->next = NULL;
+    job->func = func;
+    job->arg = arg;
+    job->cost = 0;
+    job->priority = priority;
+    job->incremental = 0;
+    job->queued = 0;
+}
+
+/*
+ * queue <job> for the next vertical blank(s) behind all jobs of the same or
+ * higher priority. <cost> is the estimated work in CPU cycles. Resubmitting
+ * a job that is still queued only updates its cost. Without a VBL hook, the
+ * job is run to completion immediately. Needs supervisor mode
+ */
+int sched_submit(struct sched_job *job, uint32_t cost)
+{
+    struct sched_job **link;
+
+    if (!vbl_hooked)
+        vbl_hooked = vbl_install() == 0 && vbl_add(sched_vbl) == 0;
+
+    if (!vbl_hooked)
+    {
+        while (cost != 0)
+            cost = job->func(job, UINT32_MAX);
+        return -1;
+    }
+
+    locked = 1;
+    job->cost = cost;
+    if (!job->queued)
+    {
+        for (link = &queue; *link != NULL && (*link)->priority <= job->priority; link = &(*link)->next)
+            ;
+        job->next = *link;
+        *link = job;
+        job->queued = 1;
+    }
+    locked = 0;
+
+    return 0;
+}
+
+/*
+ * take <job> off the queue. Work it didn't do yet is lost
+ */
+void sched_cancel(struct sched_job *job)
+{
+    locked = 1;
+    for (struct sched_job **link = &queue; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == job)
+        {
+            dequeue(link);
+            break;
+        }
+    }
+    locked = 0;
+}
+
+/*
+ * wait until <job> is done
+ */
+void sched_wait(struct sched_job *job)
+{
+    do {} while (job->queued);
+}
+
+/*
+ * take the VBL hook out again. Jobs still queued are run to completion right
+ * away, like without a hook. Needs supervisor mode
+ */
+void sched_exit(void)
+{
+    locked = 1;
+    vbl_del(sched_vbl);
+    vbl_hooked = 0;
+    locked = 0;
+
+    while (queue != NULL)
+    {
+        struct sched_job *job = queue;
+
+        while (job->cost != 0)
+            job->cost = job->func(job, UINT32_MAX);
+        dequeue(&queue);
+    }
+}
+
+/*
+ * CPU cycles the video RAM needs to take one line of <s>
+ */
+static uint32_t line_cost(const struct vram_surface *s)
+{
+    return (uint32_t) s->pitch * SCHED_CPU_MHZ / (modesel_config.vram_bandwidth / 1000000UL) + 1;
+}
+
+static uint32_t clear_job(struct sched_job *job, uint32_t budget)
+{
+    struct sched_clear *clear = job->arg;
+    struct vram_surface *s = clear->surface;
+    uint32_t cost = line_cost(s);
+    uint32_t lines = budget / cost;
+
+    if (lines == 0)
+        lines = 1;
+    if (lines > (uint32_t) (s->height - clear->y))
+        lines = s->height - clear->y;
+
+    pixel_fill_rect(s, 0, clear->y, s->width, lines, clear->color);
+    clear->y += lines;
+
+    return (uint32_t) (s->height - clear->y) * cost;
+}
+
+/*
+ * clear <surface> to <color> over as many frames as it takes, in bands that
+ * fit the blanking time. Needs supervisor mode
+ */
+void sched_clear(struct sched_clear *clear, struct vram_surface *surface, uint32_t color)
+{
+    sched_cancel(&clear->job);
+
+    sched_job_init(&clear->job, clear_job, clear, SCHED_PRIO_CLEAR);
+    clear->job.incremental = 1;
+    clear->surface = surface;
+    clear->color = color;
+    clear->y = 0;
+
+    sched_submit(&clear->job, (uint32_t) surface->height * line_cost(surface));
+}
+
+/*
+ * derive the per frame budget from the vertical blanking time of <ml>
+ */
+void sched_set_timing(const struct modeline *ml)
+{
+    uint32_t lines = ml->v_total - ml->v_display;
+
+    if (ml->pixel_clock <= 0)
+    {
+        frame_budget = 0;
+        return;
+    }
+
+    if (ml->flags.double_scan)
+        lines *= 2;
+    else if (ml->flags.interlace)
+        lines /= 2;
+
+    frame_budget = lines * ml->h_total / 100 * SCHED_CPU_MHZ * SCHED_BUDGET_PERCENT / ml->pixel_clock;
+}
+
+uint32_t sched_budget(void)
+{
+    return frame_budget;
+}
@@ -0,0 +1,69 @@
+/*
+ * sched.h - vertical blank frame scheduler
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include "modeline.h"
+#include "vram.h"
+
+#define SCHED_CPU_MHZ           264     /* ColdFire core clock */
+#define SCHED_BUDGET_PERCENT    75      /* share of the blanking time handed to jobs */
+#define SCHED_REG_CYCLES        16      /* one video register or CLUT write across the FlexBus */
+
+/* lower values run first */
+enum sched_priority
+{
+    SCHED_PRIO_COMMIT = 0,      /* VIDEL register changes (videl_shadow.c) */
+    SCHED_PRIO_FLIP = 1,        /* page flips (flip.c) */
+    SCHED_PRIO_CLUT = 2,        /* palette uploads (clut.c) */
+    SCHED_PRIO_DEFAULT = 4,
+    SCHED_PRIO_CLEAR = 8
+};
+
+struct sched_job;
+
+/*
+ * do (at most) <budget> cycles worth of work and return the estimated cycles
+ * still left to do; 0 takes the job off the queue
+ */
+typedef uint32_t (*sched_func)(struct sched_job *job, uint32_t budget);
+
+struct sched_job
+{
+    struct sched_job *next;
+    sched_func func;
+    void *arg;
+    uint32_t cost;              /* estimated cycles for the remaining work */
+    short priority;
+    short incremental;          /* may be given less budget than cost and called again */
+    volatile short queued;
+};
+
+/* an incremental clear of a whole surface, a band of lines per frame */
+struct sched_clear
+{
+    struct sched_job job;
+    struct vram_surface *surface;
+    uint32_t color;
+    short y;
+};
+
+void sched_job_init(struct sched_job *job, sched_func func, void *arg, short priority);
+
+/* these need supervisor mode */
+int sched_submit(struct sched_job *job, uint32_t cost);
+void sched_cancel(struct sched_job *job);
+void sched_wait(struct sched_job *job);
+void sched_exit(void);
+void sched_clear(struct sched_clear *clear, struct vram_surface *surface, uint32_t color);
+
+void sched_set_timing(const struct modeline *ml);
+uint32_t sched_budget(void);
+
+#endif /* SCHED_H */
@@ -0,0 +1,344 @@
+/*
+ * shadow.c - fast RAM shadow framebuffer with dirty rectangle presentation
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "shadow.h"
+#include "fb_video.h"
+#include "cursor.h"
+#include <stddef.h>
+#include <string.h>
+#include <osbind.h>
+
+/*
+ * The CPU is a lot faster on fast RAM than on ST RAM, where the screen has to
+ * be. In shadow mode, drawing goes to a surface in fast RAM with the same
+ * layout as the screen and the application reports what it changed with
+ * shadow_damage(). shadow_present() then copies just the damaged rectangles
+ * over to video RAM.
+ *
+ * Damage is kept per presentation target, so presenting alternately into the
+ * buffers of flip.c works: each buffer gets everything that changed since it
+ * was last presented to. A target seen for the first time gets the whole screen.
+ *
+ * Rectangles that touch or overlap are merged, and so are rectangles whose
+ * bounding box wastes less than it saves in per rectangle overhead. When the
+ * list is full, the new rectangle is merged with the one it grows least.
+ */
+#define MERGE_SLACK     (16 * 16)   /* pixels a merged box may waste for free */
+
+struct shadow_rect
+{
+    short x0, y0;
+    short x1, y1;               /* exclusive */
+};
+
+struct shadow_target
+{
+    void *addr;                 /* video RAM surface, NULL for an unused slot */
+    short num_rects;
+    struct shadow_rect rects[SHADOW_MAX_RECTS];
+};
+
+typedef uint32_t long_t __attribute__((may_alias));
+
+static void *shadow_block;      /* as returned by Mxalloc() */
+static struct vram_surface shadow;
+static struct shadow_target targets[SHADOW_MAX_TARGETS];
+static short next_victim;
+
+static long area(const struct shadow_rect *r)
+{
+    return (long) (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+static struct shadow_rect bounds(const struct shadow_rect *a, const struct shadow_rect *b)
+{
+    struct shadow_rect u;
+
+    u.x0 = a->x0 < b->x0 ? a->x0 : b->x0;
+    u.y0 = a->y0 < b->y0 ? a->y0 : b->y0;
+    u.x1 = a->x1 > b->x1 ? a->x1 : b->x1;
+    u.y1 = a->y1 > b->y1 ? a->y1 : b->y1;
+
+    return u;
+}
+
+/* overlapping or touching */
+static int adjacent(const struct shadow_rect *a, const struct shadow_rect *b)
+{
+    return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+static void add_rect(struct shadow_target *t, struct shadow_rect r)
+{
+    short i = 0;
+
+    while (i < t->num_rects)
+    {
+        struct shadow_rect u = bounds(&t->rects[i], &r);
+
+        if (adjacent(&t->rects[i], &r) || area(&u) - area(&t->rects[i]) - area(&r) <= MERGE_SLACK)
+        {
+            /* take it out and start over, the bigger box may now reach others */
+            r = u;
+            t->rects[i] = t->rects[--t->num_rects];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+
+    if (t->num_rects == SHADOW_MAX_RECTS)
+    {
+        short best = 0;
+        long best_growth = 0x7fffffff;
+
+        for (i = 0; i < t->num_rects; i++)
+        {
+            struct shadow_rect u = bounds(&t->rects[i], &r);
+            long growth = area(&u) - area(&t->rects[i]);
+
+            if (growth < best_growth)
+            {
+                best_growth = growth;
+                best = i;
+            }
+        }
+        r = bounds(&t->rects[best], &r);
+        t->rects[best] = t->rects[--t->num_rects];
+
+        add_rect(t, r);
+        return;
+    }
+
+    t->rects[t->num_rects++] = r;
+}
+
+static void damage_target(struct shadow_target *t)
+{
+    t->num_rects = 1;
+    t->rects[0].x0 = 0;
+    t->rects[0].y0 = 0;
+    t->rects[0].x1 = shadow.width;
+    t->rects[0].y1 = shadow.height;
+}
+
+/*
+ * allocate a <width> x <height> x <bpp> shadow surface, preferably in fast RAM.
+ * It has the same pitch as a video RAM surface of that size
+ */
+int shadow_init(short width, short height, short bpp)
+{
+    long pitch = vram_pitch(width, bpp);
+
+    shadow_block = (void *) Mxalloc(pitch * height + 15, MX_PREFTTRAM);
+    if (shadow_block == NULL)
+        return -1;
+
+    /* line aligned, as the video RAM side */
+    shadow.addr = (void *) (((uintptr_t) shadow_block + 15) & ~(uintptr_t) 15);
+    shadow.width = width;
+    shadow.height = height;
+    shadow.bpp = bpp;
+    shadow.pitch = pitch;
+    shadow.size = pitch * height;
+    memset(shadow.addr, 0, shadow.size);
+
+    memset(targets, 0, sizeof(targets));
+    next_victim = 0;
+
+    return 0;
+}
+
+void shadow_exit(void)
+{
+    if (shadow_block != NULL)
+        Mfree(shadow_block);
+
+    shadow_block = NULL;
+    shadow.addr = NULL;
+}
+
+struct vram_surface *shadow_surface(void)
+{
+    return &shadow;
+}
+
+/*
+ * report a changed <w> x <h> rectangle at <x>, <y>
+ */
+void shadow_damage(short x, short y, short w, short h)
+{
+    struct shadow_rect r = { x, y, x + w, y + h };
+
+    if (r.x0 < 0)
+        r.x0 = 0;
+    if (r.y0 < 0)
+        r.y0 = 0;
+    if (r.x1 > shadow.width)
+        r.x1 = shadow.width;
+    if (r.y1 > shadow.height)
+        r.y1 = shadow.height;
+    if (r.x0 >= r.x1 || r.y0 >= r.y1)
+        return;
+
+    for (short i = 0; i < SHADOW_MAX_TARGETS; i++)
+        if (targets[i].addr != NULL)
+            add_rect(&targets[i], r);
+}
+
+void shadow_damage_all(void)
+{
+    for (short i = 0; i < SHADOW_MAX_TARGETS; i++)
+        damage_target(&targets[i]);
+}
+
+/*
+ * copy <bytes> (a multiple of 4) from long aligned <src> to long aligned <dst>,
+ * four longs (one ColdFire line burst) at a time
+ */
+static void copy_longs(uint8_t *dst, const uint8_t *src, long bytes)
+{
+    long_t *d = (long_t *) dst;
+    const long_t *s = (const long_t *) src;
+
+    for (; bytes >= 16; bytes -= 16, d += 4, s += 4)
+    {
+        uint32_t a = s[0], b = s[1], c = s[2], e = s[3];
+
+        d[0] = a;
+        d[1] = b;
+        d[2] = c;
+        d[3] = e;
+    }
+    for (; bytes > 0; bytes -= 4)
+        *d++ = *s++;
+}
+
+static struct shadow_target *find_target(void *addr)
+{
+    struct shadow_target *t;
+
+    for (short i = 0; i < SHADOW_MAX_TARGETS; i++)
+        if (targets[i].addr == addr)
+            return &targets[i];
+
+    /* new target - take a free slot, or round robin replace one */
+    t = NULL;
+    for (short i = 0; i < SHADOW_MAX_TARGETS && t == NULL; i++)
+        if (targets[i].addr == NULL)
+            t = &targets[i];
+    if (t == NULL)
+    {
+        t = &targets[next_victim];
+        next_victim = (next_victim + 1) % SHADOW_MAX_TARGETS;
+    }
+
+    t->addr = addr;
+    damage_target(t);
+
+    return t;
+}
+
+/*
+ * what copying <r> really overwrites on the screen: the damaged bytes rounded
+ * out to whole longs, in pixels. If lines aren't a multiple of 4 bytes long,
+ * the rounding differs from line to line and a long may reach into the line
+ * above or below, so take full lines and one more on either side
+ */
+static struct shadow_rect copied_rect(const struct shadow_rect *r, short bits)
+{
+    struct shadow_rect c = *r;
+
+    if (shadow.pitch & 3)
+    {
+        c.x0 = 0;
+        c.x1 = shadow.width;
+        if (c.y0 > 0)
+            c.y0--;
+        if (c.y1 < shadow.height)
+            c.y1++;
+    }
+    else
+    {
+        c.x0 = (((long) r->x0 * bits / 8) & ~3L) * 8 / bits;
+        c.x1 = (((((long) r->x1 * bits + 7) / 8 + 3) & ~3L) * 8 + bits - 1) / bits;
+        if (c.x1 > shadow.width)
+            c.x1 = shadow.width;
+    }
+
+    return c;
+}
+
+/*
+ * bring <screen> (same size and depth as the shadow surface) up to date.
+ * Copies whole longs, so up to three bytes left and right of each damaged
+ * line go along. Returns the number of bytes copied
+ */
+long shadow_present(struct vram_surface *screen)
+{
+    struct shadow_target *t = find_target(screen->addr);
+    short bits = fb_pixel_bits(shadow.bpp);
+    struct shadow_rect box;
+    long total = 0;
+
+    if (t->num_rects == 0)
+        return 0;
+
+    /* the mouse cursor is only on the screen, don't copy over it */
+    box = copied_rect(&t->rects[0], bits);
+    for (short i = 1; i < t->num_rects; i++)
+    {
+        struct shadow_rect c = copied_rect(&t->rects[i], bits);
+
+        box = bounds(&box, &c);
+    }
+    cursor_begin(screen, box.x0, box.y0, box.x1 - box.x0, box.y1 - box.y0);
+
+    for (short i = 0; i < t->num_rects; i++)
+    {
+        struct shadow_rect *r = &t->rects[i];
+        long line = (long) r->y0 * shadow.pitch;
+
+        for (short y = r->y0; y < r->y1; y++, line += shadow.pitch)
+        {
+            /*
+             * both buffers are 16 byte aligned, so rounding the offsets aligns
+             * the addresses. Lines aren't necessarily a multiple of 4 bytes
+             * long, a long may reach into the neighbour line, which is harmless
+             */
+            long first = (line + (long) r->x0 * bits / 8) & ~3L;
+            long last = (line + ((long) r->x1 * bits + 7) / 8 + 3) & ~3L;
+            long longs;
+
+            if (last > shadow.size)
+                last = shadow.size;
+            longs = (last - first) & ~3L;
+
+            copy_longs((uint8_t *) screen->addr + first, (uint8_t *) shadow.addr + first, longs);
+            if (longs < last - first)
+                memcpy((uint8_t *) screen->addr + first + longs, (uint8_t *) shadow.addr + first + longs,
+                       last - first - longs);
+            total += last - first;
+        }
+    }
+    t->num_rects = 0;
+    cursor_end();
+
+    return total;
+}
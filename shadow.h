@@ -0,0 +1,24 @@
+/*
+ * shadow.h - fast RAM shadow framebuffer with dirty rectangle presentation
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include "vram.h"
+#include "flip.h"
+
+#define SHADOW_MAX_RECTS    16
+#define SHADOW_MAX_TARGETS  FLIP_MAX_BUFFERS
+
+int shadow_init(short width, short height, short bpp);
+void shadow_exit(void);
+struct vram_surface *shadow_surface(void);
+void shadow_damage(short x, short y, short w, short h);
+void shadow_damage_all(void);
+long shadow_present(struct vram_surface *screen);
+
+#endif /* SHADOW_H */
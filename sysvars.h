@@ -0,0 +1,26 @@
+/*
+ * sysvars.h - the TOS system variables the driver uses
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef SYSVARS_H
+#define SYSVARS_H
+
+#include <stdint.h>
+
+/* all of these need supervisor mode */
+#ifdef FB_HOST
+#include "emu.h"
+
+#define hz_200      (emu_sysvars.hz_200)
+#define nvbls       (emu_sysvars.nvbls)
+#define vblqueue    (emu_sysvars.vblqueue)
+#else
+#define hz_200      (*(volatile uint32_t *) 0x4ba)              /* 200 Hz system timer */
+#define nvbls       (*(volatile int16_t *) 0x454)               /* VBL queue length */
+#define vblqueue    (*(void (** volatile *)(void)) 0x456)       /* VBL queue */
+#endif
+
+#endif /* SYSVARS_H */
@@ -0,0 +1,155 @@
+/*
+ * trace.c - optional tracing of video hardware register writes
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "trace.h"
+
+#ifdef FB_TRACE
+
+#include <stdio.h>
+
+/*
+ * Register writes and phase marks go into a ring buffer that keeps the last
+ * TRACE_RING_SIZE entries. Phase marks also record their time separately,
+ * so trace_report() can tell how long each step of the last full mode switch
+ * took, even if the ring has wrapped since.
+ *
+ * The 200 Hz system timer is far too coarse for that. On the FireBee, the
+ * timestamps come from ColdFire slice timer 0, which BaS_gcc leaves running
+ * as a free running down counter at the 132 MHz system bus clock; it wraps
+ * after half a minute, more than enough for a mode switch. Reading it needs
+ * supervisor mode, as do all the register writes it timestamps.
+ */
+#ifdef __mcoldfire__
+#define slt0_count  (*(volatile uint32_t *) 0xff000908)     /* MBAR + 0x908 */
+
+#define TRACE_CLOCK_MHZ     132
+
+uint32_t trace_clock(void)
+{
+    return ~slt0_count;
+}
+#else
+#include <time.h>
+
+#define TRACE_CLOCK_MHZ     1                   /* microseconds */
+
+uint32_t trace_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+static const char * const phase_names[TRACE_NUM_PHASES] =
+{
+    "video off",
+    "PLL start",
+    "timing writes",
+    "setup while PLL settles",
+    "PLL settle",
+    "video on",
+    "done"
+};
+
+static struct trace_entry ring[TRACE_RING_SIZE];
+static uint32_t ring_count;                     /* entries logged since trace_reset() */
+static uint32_t phase_time[TRACE_NUM_PHASES];
+static short phase_seen[TRACE_NUM_PHASES];
+
+static void log_entry(uint32_t addr, short size, uint32_t value)
+{
+    struct trace_entry *e = &ring[ring_count++ & (TRACE_RING_SIZE - 1)];
+
+    e->time = trace_clock();
+    e->addr = addr;
+    e->size = size;
+    e->value = value;
+}
+
+void trace_reg(volatile void *reg, short size, uint32_t value)
+{
+    log_entry((uint32_t) (uintptr_t) reg, size, value);
+}
+
+/*
+ * mark the start of <phase>. TRACE_VIDEO_OFF starts a new mode switch
+ */
+void trace_phase(enum trace_phase phase)
+{
+    if (phase == TRACE_VIDEO_OFF)
+    {
+        for (short i = 0; i < TRACE_NUM_PHASES; i++)
+            phase_seen[i] = 0;
+    }
+
+    log_entry(0, 0, phase);
+    phase_time[phase] = ring[(ring_count - 1) & (TRACE_RING_SIZE - 1)].time;
+    phase_seen[phase] = 1;
+}
+
+void trace_reset(void)
+{
+    ring_count = 0;
+    for (short i = 0; i < TRACE_NUM_PHASES; i++)
+        phase_seen[i] = 0;
+}
+
+/*
+ * print the logged register writes and the phase timing of the last mode switch
+ */
+void trace_report(void)
+{
+    uint32_t first = ring_count > TRACE_RING_SIZE ? ring_count - TRACE_RING_SIZE : 0;
+    uint32_t start = ring[first & (TRACE_RING_SIZE - 1)].time;
+
+    printf("%10s %10s %4s %10s\r\n", "us", "register", "size", "value");
+    for (uint32_t i = first; i < ring_count; i++)
+    {
+        const struct trace_entry *e = &ring[i & (TRACE_RING_SIZE - 1)];
+        unsigned long us = (e->time - start) / TRACE_CLOCK_MHZ;
+
+        if (e->addr == 0)
+            printf("%10lu --- %s\r\n", us, phase_names[e->value]);
+        else
+            printf("%10lu 0x%08lx %4d 0x%08lx\r\n", us, (unsigned long) e->addr, e->size, (unsigned long) e->value);
+    }
+
+    if (!phase_seen[TRACE_VIDEO_OFF] || !phase_seen[TRACE_DONE])
+        return;
+
+    printf("last mode switch:\r\n");
+    for (short i = TRACE_VIDEO_OFF; i < TRACE_DONE; i++)
+    {
+        short next = i + 1;
+
+        if (!phase_seen[i])
+            continue;
+        while (!phase_seen[next])
+            next++;
+
+        printf("  %-24s %8lu us\r\n", phase_names[i],
+               (unsigned long) (phase_time[next] - phase_time[i]) / TRACE_CLOCK_MHZ);
+    }
+    printf("  %-24s %8lu us\r\n", "video off in total",
+           (unsigned long) (phase_time[TRACE_DONE] - phase_time[TRACE_VIDEO_OFF]) / TRACE_CLOCK_MHZ);
+}
+
+#endif /* FB_TRACE */
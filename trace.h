@@ -0,0 +1,78 @@
+/*
+ * trace.h - optional tracing of video hardware register writes
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Build with -DFB_TRACE ('make TRACE=1') to log every video register write
+ * with a timestamp. Without it, REG_WRITE() is a plain assignment and the
+ * rest compiles to nothing. REG_WRITE() evaluates <reg> more than once, so it
+ * must not have side effects
+ */
+#define TRACE_RING_SIZE     256     /* entries, a power of two */
+
+/* the host emulator (emu.c) needs to see register writes to react to them */
+#ifdef FB_HOST
+#include "emu.h"
+
+#define REG_NOTIFY(reg)     emu_write(&(reg))
+#else
+#define REG_NOTIFY(reg)     ((void) 0)
+#endif
+
+/* the steps of a full mode switch (videl_commit() with a new pixel clock) */
+enum trace_phase
+{
+    TRACE_VIDEO_OFF,                /* switch video off */
+    TRACE_PLL_START,                /* wait for the PLL to be idle, start reprogramming it */
+    TRACE_TIMING,                   /* write timing, scan and depth registers */
+    TRACE_SETUP,                    /* caller's work while the PLL settles */
+    TRACE_PLL_SETTLE,               /* wait for the PLL */
+    TRACE_VIDEO_ON,                 /* switch video on */
+    TRACE_DONE,
+    TRACE_NUM_PHASES
+};
+
+#ifdef FB_TRACE
+
+struct trace_entry
+{
+    uint32_t time;                  /* trace_clock() ticks */
+    uint32_t addr;                  /* register address, 0 for a phase mark */
+    uint32_t value;                 /* value written or enum trace_phase */
+    short size;                     /* bytes written */
+};
+
+uint32_t trace_clock(void);
+void trace_reg(volatile void *reg, short size, uint32_t value);
+void trace_phase(enum trace_phase phase);
+void trace_reset(void);
+void trace_report(void);
+
+#define REG_WRITE(reg, value)                                           \
+    do                                                                  \
+    {                                                                   \
+        __typeof__(reg) reg_value_ = (value);                           \
+                                                                        \
+        trace_reg(&(reg), sizeof(reg), (uint32_t) reg_value_);          \
+        (reg) = reg_value_;                                             \
+        REG_NOTIFY(reg);                                                \
+    } while (0)
+
+#define TRACE_PHASE(phase)  trace_phase(phase)
+
+#else
+
+#define REG_WRITE(reg, value)   ((reg) = (value), REG_NOTIFY(reg))
+#define TRACE_PHASE(phase)      ((void) 0)
+
+#endif /* FB_TRACE */
+
+#endif /* TRACE_H */
@@ -0,0 +1,109 @@
+/*
+ * vbl.c - vertical blank interrupt hooks
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "vbl.h"
+#include "sysvars.h"
+#include <stddef.h>
+
+/*
+ * The TOS VBL handler saves all registers before it calls the queue
+ * entries, so plain C functions will do
+ */
+
+volatile uint32_t vbl_count;
+
+static vbl_func hooks[VBL_MAX_HOOKS];
+static vbl_func *queue_slot;
+
+/*
+ * called from the TOS VBL queue once per frame, i.e. during vertical blank
+ */
+static void vbl_dispatch(void)
+{
+    vbl_count++;
+
+    for (short i = 0; i < VBL_MAX_HOOKS; i++)
+    {
+        vbl_func func = hooks[i];
+
+        if (func != NULL)
+            func();
+    }
+}
+
+/*
+ * put vbl_dispatch() into a free slot of the TOS VBL queue
+ */
+int vbl_install(void)
+{
+    vbl_func *queue = vblqueue;
+
+    if (queue_slot != NULL)
+        return 0;
+
+    for (short i = 0; i < nvbls; i++)
+    {
+        if (queue[i] == NULL)
+        {
+            queue_slot = &queue[i];
+            *queue_slot = vbl_dispatch;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void vbl_remove(void)
+{
+    if (queue_slot != NULL)
+        *queue_slot = NULL;
+    queue_slot = NULL;
+}
+
+int vbl_add(vbl_func func)
+{
+    for (short i = 0; i < VBL_MAX_HOOKS; i++)
+    {
+        if (hooks[i] == NULL)
+        {
+            hooks[i] = func;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void vbl_del(vbl_func func)
+{
+    for (short i = 0; i < VBL_MAX_HOOKS; i++)
+    {
+        if (hooks[i] == func)
+            hooks[i] = NULL;
+    }
+}
+
+/*
+ * wait for the next vertical blank
+ */
+void vbl_wait(void)
+{
+    uint32_t count = vbl_count;
+
+    do {} while (vbl_count == count);
+}
@@ -0,0 +1,27 @@
+/*
+ * vbl.h - vertical blank interrupt hooks
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef VBL_H
+#define VBL_H
+
+#include <stdint.h>
+
+#define VBL_MAX_HOOKS   8
+
+typedef void (*vbl_func)(void);
+
+extern volatile uint32_t vbl_count;
+
+/* these need supervisor mode */
+int vbl_install(void);
+void vbl_remove(void);
+
+int vbl_add(vbl_func func);
+void vbl_del(vbl_func func);
+void vbl_wait(void);
+
+#endif /* VBL_H */
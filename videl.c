@@ -0,0 +1,148 @@
+/*
+ * videl.c - FireBee VIDEL timing register handling
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "videl.h"
+#include "trace.h"
+
+/*
+ * translate a modeline into VIDEL timing register values. This does not touch
+ * the hardware, so it's also used by the host side mode table generator.
+ *
+ * The vertical registers count scanned lines of one field. A doublescan modeline
+ * counts source lines, which are scanned twice; an interlaced one counts the
+ * lines of both fields. An interlaced field has half a line more than the
+ * registers say, which the VIDEL adds with halfline hsyncs (see videl_write_scan())
+ */
+void videl_timing_from_modeline(const struct modeline *ml, struct videl_timing *vt)
+{
+    unsigned short left_margin = (ml->h_total - ml->h_display) / 2;
+    unsigned short v_display = ml->v_display;
+    unsigned short v_total = ml->v_total;
+    unsigned short v_sync = ml->v_sync_end - ml->v_sync_start;
+    unsigned short upper_margin;
+
+    if (ml->flags.double_scan)
+    {
+        v_display *= 2;
+        v_total *= 2;
+        v_sync *= 2;
+    }
+    else if (ml->flags.interlace)
+    {
+        v_display /= 2;
+        v_total /= 2;
+        v_sync = (v_sync + 1) / 2;
+    }
+    upper_margin = (v_total - v_display) / 2;
+
+    vt->hht = ml->h_total;
+    vt->hde = left_margin - 1 + ml->h_display;
+    vt->hbe = left_margin - 1;
+    vt->hdb = left_margin;
+    vt->hbb = left_margin + ml->h_display;
+    vt->hss = ml->h_total - (ml->h_sync_end - ml->h_sync_start);
+
+    vt->vft = v_total;
+    vt->vde = upper_margin + v_display - 1;
+    vt->vbe = upper_margin - 1;
+    vt->vdb = upper_margin;
+    vt->vbb = upper_margin + v_display;
+
+    vt->vss = v_total - v_sync;
+}
+
+/*
+ * video mode register bits for the scan type of a modeline
+ */
+uint16_t videl_scan_bits(const struct modeline_flags *flags)
+{
+    if (flags->double_scan)
+        return VMODE_DOUBLE_SCAN;
+    if (flags->interlace)
+        return VMODE_INTERLACE;
+
+    return 0;
+}
+
+/*
+ * set the scan type. Interlace also needs halfline hsyncs, so the fields
+ * get their extra half line
+ */
+void videl_write_scan(uint16_t vmode, volatile struct videl_registers *vr)
+{
+    REG_WRITE(vr->vco, (vr->vco & ~VMODE_SCAN_MASK) | vmode);
+
+    if (vmode & VMODE_INTERLACE)
+        REG_WRITE(vr->vclk, vr->vclk | VCO_HALFLINE_HSYNC);
+    else
+        REG_WRITE(vr->vclk, vr->vclk & ~VCO_HALFLINE_HSYNC);
+}
+
+/*
+ * check that <vt> fits into the VIDEL registers and that blank, display and sync
+ * come in the order the counters need. Returns 1 if it does, 0 if not
+ */
+int videl_timing_valid(const struct videl_timing *vt)
+{
+    const uint16_t hmax = (1 << VIDEL_HREG_BITS) - 1;
+    const uint16_t vmax = (1 << VIDEL_VREG_BITS) - 1;
+
+    if (vt->hht > hmax || vt->hbb > hmax || vt->hbe > hmax || vt->hdb > hmax || vt->hde > hmax || vt->hss > hmax)
+        return 0;
+
+    if (vt->vft > vmax || vt->vbb > vmax || vt->vbe > vmax || vt->vdb > vmax || vt->vde > vmax || vt->vss > vmax)
+        return 0;
+
+    /* a margin of 0 lets hbe and vbe wrap around */
+    if (vt->hbe >= vt->hdb || vt->hdb > vt->hde || vt->hde >= vt->hbb || vt->hbb > vt->hss || vt->hss > vt->hht)
+        return 0;
+
+    if (vt->vbe >= vt->vdb || vt->vdb > vt->vde || vt->vde >= vt->vbb || vt->vbb > vt->vss || vt->vss > vt->vft)
+        return 0;
+
+    return 1;
+}
+
+void fbee_set_screen(volatile struct videl_registers *regs, void *adr)
+{
+    REG_WRITE(regs->vbasx, ((unsigned long) adr >> 16) & 0x3ff);
+    REG_WRITE(regs->vbasm, ((unsigned long) adr >> 8) & 0xff);
+    REG_WRITE(regs->vbasl, ((unsigned long) adr));
+}
+
+/*
+ * write (precalculated) timing values to the VIDEL
+ */
+void videl_write_timing(const struct videl_timing *vt, volatile struct videl_registers *vr)
+{
+    REG_WRITE(vr->hht, vt->hht);
+    REG_WRITE(vr->hde, vt->hde);
+    REG_WRITE(vr->hbe, vt->hbe);
+    REG_WRITE(vr->hdb, vt->hdb);
+    REG_WRITE(vr->hbb, vt->hbb);
+    REG_WRITE(vr->hss, vt->hss);
+
+    REG_WRITE(vr->vft, vt->vft);
+    REG_WRITE(vr->vde, vt->vde);
+    REG_WRITE(vr->vbe, vt->vbe);
+    REG_WRITE(vr->vdb, vt->vdb);
+    REG_WRITE(vr->vbb, vt->vbb);
+
+    REG_WRITE(vr->vss, vt->vss);
+}
@@ -0,0 +1,80 @@
+/*
+ * videl.h - FireBee VIDEL timing register handling
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef VIDEL_H
+#define VIDEL_H
+
+#include <stdint.h>
+#include "fb_video.h"
+#include "modeline.h"
+
+/*
+ * the VIDEL timing registers a modeline translates into. Kept separate from
+ * struct videl_registers so it can be precomputed and stored in tables
+ */
+struct videl_timing
+{
+    uint16_t hht;
+    uint16_t hbb;
+    uint16_t hbe;
+    uint16_t hdb;
+    uint16_t hde;
+    uint16_t hss;
+    uint16_t vft;
+    uint16_t vbb;
+    uint16_t vbe;
+    uint16_t vdb;
+    uint16_t vde;
+    uint16_t vss;
+};
+
+/*
+ * width of the FireBee VIDEL timing counters. Native FireBee modes count pixels
+ * and lines (not half lines like the Falcon), so the registers are wider
+ */
+#define VIDEL_HREG_BITS     12
+#define VIDEL_VREG_BITS     12
+
+void videl_timing_from_modeline(const struct modeline *ml, struct videl_timing *vt);
+int videl_timing_valid(const struct videl_timing *vt);
+void videl_write_timing(const struct videl_timing *vt, volatile struct videl_registers *vr);
+
+/*
+ * shadowed video state. Changes are staged and then committed in one go:
+ * only registers that differ from what the hardware has are written, during
+ * vertical blank. Video is only switched off if the pixel clock changes
+ */
+struct videl_state
+{
+    struct videl_timing timing;
+    uint32_t cntrl;                 /* fb_vd_cntrl colour depth bits */
+    void *base;                     /* video base address as seen by the video hardware */
+    short pixel_clock;              /* MHz */
+    uint16_t line_words;            /* VWRAP line stride, 0 leaves the register alone */
+    uint8_t hscroll;                /* pixels (0..15) the display is shifted left */
+    uint16_t vmode;                 /* scan type, enum falcon_vmode_bits */
+};
+
+uint32_t videl_color_bits(short bpp);
+uint16_t videl_scan_bits(const struct modeline_flags *flags);
+void videl_write_scan(uint16_t vmode, volatile struct videl_registers *vr);
+
+void videl_stage_timing(const struct videl_timing *vt, short pixel_clock);
+void videl_stage_depth(short bpp);
+void videl_stage_base(void *base);
+void videl_stage_line(uint16_t words);
+void videl_stage_hscroll(short pixels);
+void videl_stage_scan(uint16_t vmode);
+int videl_commit_start(void);
+int videl_commit_finish(void);
+int videl_commit(void);
+void videl_commit_wait(void);
+void videl_exit(void);
+void videl_write_base(void *base);
+void videl_invalidate(void);
+
+#endif /* VIDEL_H */
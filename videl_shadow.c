@@ -0,0 +1,306 @@
+/*
+ * videl_shadow.c - shadowed VIDEL state with diffed commits
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "videl.h"
+#include "sched.h"
+#include "pll.h"
+#include "trace.h"
+#include <stddef.h>
+
+static struct videl_state current;      /* what the hardware has */
+static struct videl_state next;         /* what has been staged */
+static struct videl_state committed;    /* what the commit job is going to write */
+static short current_valid;
+static volatile short commit_pending;
+static volatile short commit_locked;
+static struct sched_job commit_job;
+static short full_commit_running;
+
+/* worst case: all timing registers, control, base, line width, scroll and scan mode */
+#define COMMIT_COST     (20 * SCHED_REG_CYCLES)
+
+uint32_t videl_color_bits(short bpp)
+{
+    switch (bpp)
+    {
+        case 1:
+            return COLOR1;
+        case 8:
+            return COLOR8;
+        case 16:
+            return COLOR16;
+        case 24:
+            return COLOR24;
+        default:
+            return 0;
+    }
+}
+
+void videl_stage_timing(const struct videl_timing *vt, short pixel_clock)
+{
+    next.timing = *vt;
+    next.pixel_clock = pixel_clock;
+}
+
+void videl_stage_depth(short bpp)
+{
+    next.cntrl = videl_color_bits(bpp);
+}
+
+void videl_stage_base(void *base)
+{
+    next.base = base;
+}
+
+/*
+ * distance from one line to the next in words. A stride wider than the display
+ * shows a window of a wider surface
+ */
+void videl_stage_line(uint16_t words)
+{
+    next.line_words = words;
+}
+
+void videl_stage_hscroll(short pixels)
+{
+    next.hscroll = pixels & 15;
+}
+
+/*
+ * progressive, interlace or doublescan (videl_scan_bits()). Belongs to the
+ * timing, so stage it with videl_stage_timing()
+ */
+void videl_stage_scan(uint16_t vmode)
+{
+    next.vmode = vmode;
+}
+
+/*
+ * forget what we know about the hardware, the next commit writes everything
+ */
+void videl_invalidate(void)
+{
+    current_valid = 0;
+}
+
+/*
+ * base address change from somebody else's scheduler job (page flipping)
+ */
+void videl_write_base(void *base)
+{
+    fbee_set_screen(videl_regs, base);
+    current.base = next.base = committed.base = base;
+}
+
+#define COMMIT_TIMING(reg)  if (st->timing.reg != current.timing.reg) REG_WRITE(videl_regs->reg, st->timing.reg)
+
+/*
+ * write the registers of <st> that differ from the current hardware state
+ */
+static void commit_diff(const struct videl_state *st)
+{
+    COMMIT_TIMING(hht);
+    COMMIT_TIMING(hde);
+    COMMIT_TIMING(hbe);
+    COMMIT_TIMING(hdb);
+    COMMIT_TIMING(hbb);
+    COMMIT_TIMING(hss);
+
+    COMMIT_TIMING(vft);
+    COMMIT_TIMING(vde);
+    COMMIT_TIMING(vbe);
+    COMMIT_TIMING(vdb);
+    COMMIT_TIMING(vbb);
+    COMMIT_TIMING(vss);
+
+    if (st->cntrl != current.cntrl)
+        REG_WRITE(*fb_vd_cntrl, (*fb_vd_cntrl & ~COLMASK) | st->cntrl);
+
+    if (st->base != current.base)
+        fbee_set_screen(videl_regs, st->base);
+
+    if (st->line_words != 0 && st->line_words != current.line_words)
+        REG_WRITE(videl_regs->vwrap, st->line_words);
+
+    if (st->hscroll != current.hscroll)
+        REG_WRITE(videl_regs->hscroll, st->hscroll);
+
+    if (st->vmode != current.vmode)
+        videl_write_scan(st->vmode, videl_regs);
+
+    current = *st;
+}
+
+/*
+ * new pixel clock (or unknown hardware state): switch video off, start
+ * reprogramming the PLL and write everything else while it settles.
+ * commit_full_finish() switches video on again
+ */
+static void commit_full_start(const struct videl_state *st)
+{
+    TRACE_PHASE(TRACE_VIDEO_OFF);
+    fbee_set_screen(videl_regs, st->base);
+
+    /*
+     * disable Falcon shift mode and ST shift mode on the FireBee video side,
+     * disable FireBee video and disable the video DAC -
+     * this will leave you with a black screen and no video at all
+     */
+    REG_WRITE(*fb_vd_cntrl, *fb_vd_cntrl & ~(FALCON_SHIFT_MODE | ST_SHIFT_MODE | FB_VIDEO_ON | VIDEO_DAC_ON));
+
+    /* it appears we can only enable FireBee video if we write 0 to ST shift mode
+     * and Falcon shift mode in exactly this sequence
+     *
+     * Don't write to one of these registers once you activated FireBee video as you'll
+     * be set back to Atari video
+     */
+    REG_WRITE(videl_regs->stsft, 0);
+    REG_WRITE(videl_regs->spshift, 0);
+    REG_WRITE(*fb_vd_cntrl, *fb_vd_cntrl & ~(FALCON_SHIFT_MODE | ST_SHIFT_MODE | FB_VIDEO_ON | VIDEO_DAC_ON));
+
+    /*
+     * set and activate FireBee video clock generator. Don't wait for it
+     */
+    TRACE_PHASE(TRACE_PLL_START);
+    pll_wait();
+    pll_start(st->pixel_clock, NULL);
+
+    TRACE_PHASE(TRACE_TIMING);
+    videl_write_timing(&st->timing, videl_regs);
+
+    if (st->line_words != 0)
+        REG_WRITE(videl_regs->vwrap, st->line_words);
+    REG_WRITE(videl_regs->hscroll, st->hscroll);
+    videl_write_scan(st->vmode, videl_regs);
+
+    REG_WRITE(*fb_vd_cntrl, (*fb_vd_cntrl & ~COLMASK) | st->cntrl);
+
+    current = *st;
+    current_valid = 1;
+    full_commit_running = 1;
+    TRACE_PHASE(TRACE_SETUP);
+}
+
+static int commit_full_finish(void)
+{
+    int ret;
+
+    TRACE_PHASE(TRACE_PLL_SETTLE);
+    ret = pll_wait();
+
+    /*
+     * enable video again once all the settings are done
+     */
+    TRACE_PHASE(TRACE_VIDEO_ON);
+    REG_WRITE(*fb_vd_cntrl, *fb_vd_cntrl | FB_VIDEO_ON | VIDEO_DAC_ON);
+    full_commit_running = 0;
+    TRACE_PHASE(TRACE_DONE);
+
+    /* if the PLL timed out, we don't know what clock it runs */
+    if (ret != 0)
+        current_valid = 0;
+
+    return ret;
+}
+
+/*
+ * scheduler job (sched.c), runs during vertical blank
+ */
+static uint32_t commit_job_run(struct sched_job *job, uint32_t budget)
+{
+    /* videl_commit() is just updating the state - try again next frame */
+    if (commit_locked)
+        return job->cost;
+
+    if (commit_pending)
+    {
+        commit_diff(&committed);
+        commit_pending = 0;
+    }
+    return 0;
+}
+
+/*
+ * start bringing the hardware to the staged state. If the pixel clock changed, video
+ * is switched off, all registers are written and the PLL starts reconfiguring; 1 is
+ * returned and video stays off until videl_commit_finish(), so other setup work
+ * (CLUT, clearing the screen) can be done while the PLL settles.
+ * Otherwise the changed registers are written by a job of the frame scheduler (sched.c)
+ * ahead of any other job, and 0 is returned; use videl_commit_wait() to wait for that
+ * to happen. Without a VBL hook, the registers are written immediately. Needs
+ * supervisor mode
+ */
+int videl_commit_start(void)
+{
+    if (!current_valid || next.pixel_clock != current.pixel_clock)
+    {
+        videl_commit_wait();
+        commit_full_start(&next);
+        return 1;
+    }
+
+    commit_locked = 1;
+    committed = next;
+    commit_pending = 1;
+    commit_locked = 0;
+
+    if (commit_job.func == NULL)
+        sched_job_init(&commit_job, commit_job_run, NULL, SCHED_PRIO_COMMIT);
+    sched_submit(&commit_job, COMMIT_COST);
+
+    return 0;
+}
+
+/*
+ * finish what videl_commit_start() started. Returns -1 if the PLL timed out, 0 otherwise
+ */
+int videl_commit_finish(void)
+{
+    if (full_commit_running)
+        return commit_full_finish();
+
+    return 0;
+}
+
+/*
+ * videl_commit_start() and, if video had to be switched off, videl_commit_finish().
+ * Returns 1 if video was switched off, 0 if the change is left to the commit job,
+ * -1 if the PLL timed out
+ */
+int videl_commit(void)
+{
+    if (videl_commit_start() == 0)
+        return 0;
+
+    return videl_commit_finish() == 0 ? 1 : -1;
+}
+
+void videl_commit_wait(void)
+{
+    do {} while (commit_pending);
+}
+
+/*
+ * let a pending change reach the hardware. Needs supervisor mode
+ */
+void videl_exit(void)
+{
+    videl_commit_wait();
+    sched_cancel(&commit_job);
+}
@@ -0,0 +1,150 @@
+/*
+ * vram.c - FireBee video RAM surface allocator
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "vram.h"
+#include <stddef.h>
+#include <osbind.h>
+
+/*
+ * FireBee screen buffers live in ST RAM with BaS_gcc. Instead of an Mxalloc()
+ * per screen (which fragments ST RAM and needs 255 bytes of slack each time)
+ * we get one block at vram_init() and place surfaces into it first fit.
+ *
+ * The allocation records live here, not in video RAM, sorted by offset.
+ */
+static void *arena_block;           /* as returned by Mxalloc() */
+static uintptr_t arena_base;        /* VRAM_ALIGN aligned start */
+static long arena_size;
+
+static struct vram_block
+{
+    long offset;
+    long size;
+} blocks[VRAM_MAX_SURFACES];
+static short num_blocks;
+
+static long align_up(long value, long align)
+{
+    return (value + align - 1) & ~(align - 1);
+}
+
+int vram_init(long size)
+{
+    size = align_up(size, VRAM_ALIGN);
+
+    arena_block = (void *) Mxalloc(size + VRAM_ALIGN - 1, MX_STRAM);
+    if (arena_block == NULL)
+        return -1;
+
+    arena_base = align_up((uintptr_t) arena_block, VRAM_ALIGN);
+    arena_size = size;
+    num_blocks = 0;
+
+    return 0;
+}
+
+void vram_exit(void)
+{
+    if (arena_block != NULL)
+        Mfree(arena_block);
+
+    arena_block = NULL;
+    arena_size = 0;
+    num_blocks = 0;
+}
+
+/*
+ * place a <width> x <height> x <bpp> surface into the first gap of the arena
+ * that is large enough. Returns 0 on success, -1 if the arena is exhausted
+ */
+int vram_alloc_surface(struct vram_surface *surface, short width, short height, short bpp)
+{
+    long size = vram_surface_size(width, height, bpp);
+    long offset = 0;
+    short i;
+
+    if (num_blocks >= VRAM_MAX_SURFACES)
+        return -1;
+
+    for (i = 0; i < num_blocks; i++)
+    {
+        if (blocks[i].offset - offset >= size)
+            break;
+        offset = blocks[i].offset + blocks[i].size;
+    }
+
+    if (arena_size - offset < size && i == num_blocks)
+        return -1;
+
+    for (short j = num_blocks; j > i; j--)
+        blocks[j] = blocks[j - 1];
+    blocks[i].offset = offset;
+    blocks[i].size = size;
+    num_blocks++;
+
+    surface->addr = (void *) (arena_base + offset);
+    surface->width = width;
+    surface->height = height;
+    surface->bpp = bpp;
+    surface->pitch = vram_pitch(width, bpp);
+    surface->size = size;
+
+    return 0;
+}
+
+void vram_free_surface(struct vram_surface *surface)
+{
+    long offset = (uintptr_t) surface->addr - arena_base;
+
+    for (short i = 0; i < num_blocks; i++)
+    {
+        if (blocks[i].offset == offset)
+        {
+            for (short j = i; j < num_blocks - 1; j++)
+                blocks[j] = blocks[j + 1];
+            num_blocks--;
+            break;
+        }
+    }
+    surface->addr = NULL;
+    surface->size = 0;
+}
+
+/*
+ * largest surface size that can currently be allocated
+ */
+long vram_free(void)
+{
+    long offset = 0;
+    long largest = 0;
+
+    if (num_blocks >= VRAM_MAX_SURFACES)
+        return 0;
+
+    for (short i = 0; i < num_blocks; i++)
+    {
+        if (blocks[i].offset - offset > largest)
+            largest = blocks[i].offset - offset;
+        offset = blocks[i].offset + blocks[i].size;
+    }
+    if (arena_size - offset > largest)
+        largest = arena_size - offset;
+
+    return largest;
+}
@@ -0,0 +1,42 @@
+/*
+ * vram.h - FireBee video RAM surface allocator
+ * This is part of the FireBee driver for fVDI
+ *
+ * Copyright (C) 2020 Markus Fröschle, mfro@mubf.de
+ */
+
+#ifndef VRAM_H
+#define VRAM_H
+
+#include <stdint.h>
+
+#define VRAM_ALIGN          256     /* video base addresses need to be 256 byte aligned */
+#define VRAM_WIDTH_ALIGN    8       /* line width in pixels needs to be a multiple of 8 */
+#define VRAM_MAX_SURFACES   16
+
+/*
+ * a rectangular pixel buffer in video RAM. Screens (front/back buffers) as
+ * well as off-screen surfaces (sprites, cached drawings) are carved out of a
+ * single ST RAM arena
+ */
+struct vram_surface
+{
+    void *addr;                 /* CPU address, 256 byte aligned */
+    short width;                /* visible width in pixels */
+    short height;
+    short bpp;
+    long pitch;                 /* bytes per line */
+    long size;                  /* bytes allocated */
+};
+
+/* vram_geom.c */
+long vram_pitch(short width, short bpp);
+long vram_surface_size(short width, short height, short bpp);
+
+int vram_init(long size);
+void vram_exit(void);
+int vram_alloc_surface(struct vram_surface *surface, short width, short height, short bpp);
+void vram_free_surface(struct vram_surface *surface);
+long vram_free(void);
+
+#endif /* VRAM_H */
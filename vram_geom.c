@@ -0,0 +1,46 @@
+/*
+ * vram_geom.c - FireBee video RAM surface layout
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "vram.h"
+#include "fb_video.h"
+
+/*
+ * Kept apart from the allocator (vram.c), which needs TOS, so the host
+ * builds of the benchmarks lay out their buffers the same way.
+ */
+
+static long align_up(long value, long align)
+{
+    return (value + align - 1) & ~(align - 1);
+}
+
+/*
+ * bytes per line for <width> pixels at <bpp>. The width is rounded up to what the VIDEL
+ * can fetch, 24 bpp pixels take 32 bits. Lines always start on a word boundary, which
+ * is also what the blitter needs
+ */
+long vram_pitch(short width, short bpp)
+{
+    return align_up(align_up(width, VRAM_WIDTH_ALIGN) * fb_pixel_bits(bpp) / 8, 2);
+}
+
+long vram_surface_size(short width, short height, short bpp)
+{
+    return align_up(vram_pitch(width, bpp) * height, VRAM_ALIGN);
+}
@@ -0,0 +1,289 @@
+/*
+ * vramprof.c - measure what the video scanout leaves of the memory bandwidth
+ * Copyright (C) 2020 Markus Fröschle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "modetab.h"
+#include "modesel.h"
+#include "videl.h"
+#include "vram.h"
+#include "vbl.h"
+#include "sched.h"
+#include "bench.h"
+#include "fb_video.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <osbind.h>
+
+/*
+ * Switch to every mode of the mode table in turn and measure CPU read, write
+ * and copy throughput in ST RAM (where the screens live and the scanout
+ * competes for the bus) and in fast RAM, once with video running and once
+ * with video switched off. The results go to a CSV file, one line per mode
+ * and test, with the share of the bandwidth that is left while the screen
+ * is displayed.
+ *
+ * The screen is left in the last mode of the table.
+ */
+#define PROF_BYTES      (256 * 1024L)   /* well beyond the 32 kB data cache */
+#define PROF_TICKS      (bench_ticks_per_second() / 4)
+#define PROF_MAX_MODES  64
+
+enum prof_mem { MEM_VRAM, MEM_FAST, NUM_MEMS };
+enum prof_op { OP_READ, OP_WRITE, OP_COPY };
+
+static const struct prof_test
+{
+    const char *name;
+    enum prof_op op;
+    enum prof_mem dst;
+    enum prof_mem src;
+} tests[] =
+{
+    { "vram read", OP_READ, MEM_VRAM, MEM_VRAM },
+    { "vram write", OP_WRITE, MEM_VRAM, MEM_VRAM },
+    { "vram copy", OP_COPY, MEM_VRAM, MEM_VRAM },
+    { "fast read", OP_READ, MEM_FAST, MEM_FAST },
+    { "fast write", OP_WRITE, MEM_FAST, MEM_FAST },
+    { "fast copy", OP_COPY, MEM_FAST, MEM_FAST },
+    { "fast to vram copy", OP_COPY, MEM_VRAM, MEM_FAST }
+};
+
+#define NUM_TESTS   (sizeof(tests) / sizeof(tests[0]))
+
+/* kbytes per second, [mode][test][video on] */
+static long result[PROF_MAX_MODES][NUM_TESTS][2];
+static short mode_failed[PROF_MAX_MODES];
+static short num_modes;
+
+static struct vram_surface screen;
+static struct vram_surface vram_buffer;
+static void *fast_block;
+static uint32_t *buffers[NUM_MEMS][2];     /* [memory][destination, source] */
+
+static volatile uint32_t sink;
+
+static void mem_read(const uint32_t *src, long bytes)
+{
+    uint32_t sum = 0;
+
+    for (long n = bytes / 16; n > 0; n--)
+    {
+        sum += src[0] + src[1] + src[2] + src[3];
+        src += 4;
+    }
+    sink = sum;
+}
+
+static void mem_write(uint32_t *dst, long bytes, uint32_t value)
+{
+    for (long n = bytes / 16; n > 0; n--)
+    {
+        dst[0] = value;
+        dst[1] = value;
+        dst[2] = value;
+        dst[3] = value;
+        dst += 4;
+    }
+}
+
+static void mem_copy(uint32_t *dst, const uint32_t *src, long bytes)
+{
+    for (long n = bytes / 16; n > 0; n--)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = src[3];
+        dst += 4;
+        src += 4;
+    }
+}
+
+/*
+ * run <test> until PROF_TICKS have passed, return the throughput in kbytes/s
+ */
+static long measure(const struct prof_test *test)
+{
+    uint32_t *dst = buffers[test->dst][0];
+    uint32_t *src = buffers[test->src][1];
+    long reps = 0;
+    uint32_t start;
+    uint32_t ticks;
+
+    if (dst == NULL || src == NULL)
+        return 0;
+
+    start = bench_ticks();
+    do
+    {
+        switch (test->op)
+        {
+            case OP_READ:
+                mem_read(src, PROF_BYTES);
+                break;
+            case OP_WRITE:
+                mem_write(dst, PROF_BYTES, reps);
+                break;
+            case OP_COPY:
+                mem_copy(dst, src, PROF_BYTES);
+                break;
+        }
+        reps++;
+    } while ((ticks = bench_ticks() - start) < PROF_TICKS);
+
+    return (double) PROF_BYTES * reps * bench_ticks_per_second() / ticks / 1024;
+}
+
+static int set_mode(const struct modetab_entry *m)
+{
+    vram_free_surface(&screen);
+    screen.addr = NULL;
+    if (vram_alloc_surface(&screen, m->width, m->height, m->bpp) != 0)
+        return -1;
+
+    videl_stage_timing(&m->videl, m->modeline.pixel_clock);
+    videl_stage_scan(videl_scan_bits(&m->modeline.flags));
+    videl_stage_depth(m->bpp);
+    videl_stage_base((char *) screen.addr + FB_VRAM_PHYS_OFFSET);
+
+    if (videl_commit() < 0)
+        return -1;
+    videl_commit_wait();
+
+    return 0;
+}
+
+/* runs in supervisor mode, for the video registers and the system timer */
+static long run_profile(void)
+{
+    for (short i = 0; i < num_modes; i++)
+    {
+        if (set_mode(&modetab[i]) != 0)
+        {
+            mode_failed[i] = 1;
+            continue;
+        }
+
+        for (short t = 0; t < NUM_TESTS; t++)
+            result[i][t][1] = measure(&tests[t]);
+
+        REG_WRITE(*fb_vd_cntrl, *fb_vd_cntrl & ~(FB_VIDEO_ON | VIDEO_DAC_ON));
+        for (short t = 0; t < NUM_TESTS; t++)
+            result[i][t][0] = measure(&tests[t]);
+        REG_WRITE(*fb_vd_cntrl, *fb_vd_cntrl | FB_VIDEO_ON | VIDEO_DAC_ON);
+    }
+
+    /* the VBL hooks live in this program, they must not survive it */
+    sched_exit();
+    videl_exit();
+    vbl_remove();
+
+    return 0;
+}
+
+static int write_csv(const char *name)
+{
+    FILE *fp = fopen(name, "w");
+
+    if (fp == NULL)
+        return -1;
+
+    fprintf(fp, "width,height,bpp,refresh,pixel_clock,scanout_kB/s,test,video_off_kB/s,video_on_kB/s,left_percent\n");
+    for (short i = 0; i < num_modes; i++)
+    {
+        const struct modetab_entry *m = &modetab[i];
+
+        if (mode_failed[i])
+            continue;
+
+        for (short t = 0; t < NUM_TESTS; t++)
+        {
+            long off = result[i][t][0];
+            long on = result[i][t][1];
+
+            if (off == 0)
+                continue;
+
+            fprintf(fp, "%d,%d,%d,%d,%d,%lu,%s,%ld,%ld,%ld\n",
+                    m->width, m->height, m->bpp, m->freq, m->modeline.pixel_clock,
+                    modesel_scanout_bandwidth(&m->modeline, m->bpp) / 1024,
+                    tests[t].name, off, on, on * 100 / off);
+        }
+    }
+
+    if (fclose(fp) != 0)
+        return -1;
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *csv = argc > 1 ? argv[1] : "vramprof.csv";
+    long screen_size = 0;
+
+    num_modes = modetab_size < PROF_MAX_MODES ? modetab_size : PROF_MAX_MODES;
+    for (short i = 0; i < num_modes; i++)
+    {
+        long size = vram_surface_size(modetab[i].width, modetab[i].height, modetab[i].bpp);
+
+        if (size > screen_size)
+            screen_size = size;
+    }
+
+    if (vram_init(screen_size + 2 * PROF_BYTES) != 0 ||
+        vram_alloc_surface(&vram_buffer, 1024, 2 * PROF_BYTES / 1024, 8) != 0)
+    {
+        fprintf(stderr, "%s: could not allocate video RAM\r\n", argv[0]);
+        exit(1);
+    }
+    buffers[MEM_VRAM][0] = vram_buffer.addr;
+    buffers[MEM_VRAM][1] = (uint32_t *) ((char *) vram_buffer.addr + PROF_BYTES);
+
+    fast_block = (void *) Mxalloc(2 * PROF_BYTES + 15, MX_TTRAM);
+    if (fast_block != NULL)
+    {
+        buffers[MEM_FAST][0] = (uint32_t *) (((uintptr_t) fast_block + 15) & ~15UL);
+        buffers[MEM_FAST][1] = buffers[MEM_FAST][0] + PROF_BYTES / sizeof(uint32_t);
+    }
+    else
+        printf("no fast RAM, fast RAM tests skipped\r\n");
+
+    Supexec(run_profile);
+
+    if (fast_block != NULL)
+        Mfree(fast_block);
+    vram_free_surface(&vram_buffer);
+
+    for (short i = 0; i < num_modes; i++)
+    {
+        if (mode_failed[i])
+            printf("%dx%dx%d@%d: could not set mode\r\n",
+                   modetab[i].width, modetab[i].height, modetab[i].bpp, modetab[i].freq);
+    }
+
+    if (write_csv(csv) != 0)
+    {
+        fprintf(stderr, "%s: could not write %s\r\n", argv[0], csv);
+        exit(1);
+    }
+    printf("%d modes profiled, results in %s\r\n", num_modes, csv);
+
+    return 0;
+}